@@ -48,17 +48,20 @@ char *parse_args(int argc, char **argv, wmappl_opt *opt) {
 		/* setup long options structure */
 		static struct option long_options[] = {
 			{"rcfile", 1, 0, 'f'},
+			{"rc-exec", 1, 0, 'e'},
 			{"iconpath", 1, 0, 'i'},
 			{"window", 0, 0, 'w'},
 			{"debug", 0, 0, 'd'},
+			{"prefork", 0, 0, 'p'},
+			{"lazy", 0, 0, 'l'},
 			{"version", 0, 0, 'V'},
 			{"help", 0, 0, 'h'},
 			{0, 0, 0, 0}
 		};
 
-		c = getopt_long(argc, argv, "f:i:n:wdVh", long_options, &option_index);
+		c = getopt_long(argc, argv, "f:e:i:n:wdplVh", long_options, &option_index);
 #else
-		c = getopt(argc, argv, "f:i:n:wdVh");
+		c = getopt(argc, argv, "f:e:i:n:wdplVh");
 #endif
 
 		if(c == -1)
@@ -75,6 +78,16 @@ char *parse_args(int argc, char **argv, wmappl_opt *opt) {
 				strcpy(rcfile, optarg);
 				break;
 
+			case 'e':
+				if(opt->rcexec) free(opt->rcexec);
+				opt->rcexec = (char *) malloc(sizeof(char) * (strlen(optarg) + 1));
+				if(!opt->rcexec) {
+					fprintf(stderr, "args.c (error) : malloc() opt->rcexec\n");
+					exit(1);
+				}
+				strcpy(opt->rcexec, optarg);
+				break;
+
 			case 'i':
 				if(opt->colonpath) free(opt->colonpath);
 				opt->colonpath = (char *) malloc(sizeof(char) * (strlen(optarg) + 1));
@@ -103,6 +116,14 @@ char *parse_args(int argc, char **argv, wmappl_opt *opt) {
 				opt->debugmode = 1;
 				break;
 
+			case 'p':
+				opt->prefork = 1;
+				break;
+
+			case 'l':
+				opt->lazy = 1;
+				break;
+
 			case 'V':
 				show_version();
 				break;
@@ -176,19 +197,25 @@ void show_usage()
 	printf("\n");
 
 #ifdef HAVE_GETOPT_LONG
-	printf("  -f, --rcfile [arg]  \tabsolute path of configuration file\n");
+	printf("  -f, --rcfile [arg]  \tabsolute path of configuration file, - reads it from stdin\n");
+	printf("  -e, --rc-exec [arg] \tread the configuration printed by a shell command\n");
 	printf("  -i, --iconpath [arg]\tpath to search for icons (paths separated by :'s)\n");
 	printf("  -n, --name [arg]    \twindow name (specify different names to run multiple instances)\n");
 	printf("  -w, --window        \twindowed mode (not withdrawn)\n");
 	printf("  -d, --debug         \tdump debug information to stderr\n");
+	printf("  -p, --prefork       \tlaunch commands from a small pre-forked helper process\n");
+	printf("  -l, --lazy          \tload icons when they are about to be shown\n");
 	printf("  -V, --version       \tshow version information\n");
 	printf("  -h, --help          \tshow usage information (this info)\n");
 #else
-	printf("  -f [arg]  \tabsolute path of configuration file\n");
+	printf("  -f [arg]  \tabsolute path of configuration file, - reads it from stdin\n");
+	printf("  -e [arg]  \tread the configuration printed by a shell command\n");
 	printf("  -i [arg]  \tpath to search for icons (paths separated by :'s)\n");
 	printf("  -n [arg]  \twindow name (specify different names to run multiple instances)\n");
 	printf("  -w        \twindowed mode (not withdrawn)\n");
 	printf("  -d        \tdump debug information to stderr\n");
+	printf("  -p        \tlaunch commands from a small pre-forked helper process\n");
+	printf("  -l        \tload icons when they are about to be shown\n");
 	printf("  -V        \tshow version information\n");
 	printf("  -h        \tshow usage information (this info)\n");
 #endif
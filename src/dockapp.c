@@ -24,6 +24,11 @@
  */
 
 #include "dockapp.h"
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <strings.h>
 #ifdef USE_TOOLTIPS
 #  ifdef HAVE_GETTIMEOFDAY
 #    include <sys/time.h>
@@ -42,12 +47,56 @@ Window root_window = 0;
 GC gc;
 int paint_requested;
 
+/* off-screen buffer that is painted into and then copied to draw_window */
+Pixmap back_buffer = 0;
+GC buffer_gc;
+unsigned int buffer_width, buffer_height;
+
+/* what dockapp_clear fills the back buffer with */
+Pixmap background_pixmap = None;
+unsigned long background_pixel;
+unsigned long background_serial = 0;
+
+/* the last answer of dockapp_background_uniform */
+unsigned long uniform_serial = (unsigned long) -1;
+int uniform_x, uniform_y, uniform_result;
+unsigned int uniform_w, uniform_h;
+
+/* bounding box of the back buffer area changed since the last present */
+int damaged = 0;
+int damage_x1, damage_y1, damage_x2, damage_y2;
+
 extern wmappl_opt *options;
 
 /* callback function pointers */
 void (*paint_ptr) (Display * dsp, Drawable drw, GC g); 
 void (*mouse_ptr) (int x, int y, int b, int s);
 void (*keyboard_ptr) (char kc, KeySym ks, int s);
+int (*idle_ptr) (void);
+
+/* colors resolved so far, by spec */
+#define COLOR_CACHE_SIZE 256
+
+typedef struct _CachedColor_ {
+	unsigned long pixel;
+	unsigned int rgb;		/* 0xRRGGBB */
+	int valid;			/* zero if the color couldn't be resolved */
+	struct _CachedColor_ *next;
+	char spec[1];			/* lower case, allocated with the entry */
+} CachedColor;
+
+static CachedColor *color_cache[COLOR_CACHE_SIZE];
+
+/* additional descriptors watched by the event loop */
+#define MAX_INPUTS 4
+int input_fd[MAX_INPUTS];
+void (*input_ptr[MAX_INPUTS]) (int fd);
+int input_count = 0;
+
+static int dockapp_compress_wheel(XEvent *e);
+#ifdef USE_TOOLTIPS
+static void dockapp_compress_motion(XEvent *e);
+#endif
 
 /* tooltip specific info */
 #ifdef USE_TOOLTIPS
@@ -58,7 +107,10 @@ typedef struct timeval   wmappl_time_t;
 #    define wmappl_currenttime(x)  gettimeofday((x),NULL)
 #    define wmappl_timerclear(x)   timerclear(x)
 #    define wmappl_timerisset(x)   timerisset(x)
-#    define wmappl_timerdiff(x,y)  ((((y)->tv_sec - (x)->tv_sec) * 1000000 + ((y)->tv_usec - (x)->tv_usec)) / 1000)
+#    define wmappl_timeradd(x,ms)  do { (x)->tv_sec += (ms) / 1000; (x)->tv_usec += ((ms) % 1000) * 1000; \
+                                        if((x)->tv_usec >= 1000000) { (x)->tv_sec++; (x)->tv_usec -= 1000000; } } while(0)
+/* milliseconds from x until y, rounded up so a timer never fires early */
+#    define wmappl_timerleft(x,y)  ((((y)->tv_sec - (x)->tv_sec) * 1000000 + ((y)->tv_usec - (x)->tv_usec) + 999) / 1000)
 
 #  else
 
@@ -67,7 +119,8 @@ typedef time_t           wmappl_time_t;
 #    define wmappl_currenttime(x)  (time(x))
 #    define wmappl_timerclear(x)   ((*x)=(time_t)0)
 #    define wmappl_timerisset(x)   ((*x)!=(time_t)0)
-#    define wmappl_timerdiff(x,y)  ((*y)-(*x))
+#    define wmappl_timeradd(x,s)   ((*x)+=(s))
+#    define wmappl_timerleft(x,y)  (((*y)-(*x)) * 1000)
 #  endif
 
 	#define TOOLTIP_MAX_WIDTH 45
@@ -84,7 +137,7 @@ typedef time_t           wmappl_time_t;
 	unsigned long tooltip_bg;
 
 	int           tooltipDelay = DEFAULT_TOOLTIP_DELAY;
-	wmappl_time_t still_time;
+	wmappl_time_t tooltip_deadline;	/* one-shot timer, cleared when not armed */
 #endif
 
 
@@ -121,6 +174,7 @@ int dockapp_create(char *appname, char *geometry, char **interface,
 	/* set callbacks to NULL */
 	mouse_ptr = NULL;
 	keyboard_ptr = NULL;
+	idle_ptr = NULL;
 	paint_ptr = NULL;
 
 #ifdef USE_TOOLTIPS
@@ -186,6 +240,15 @@ int dockapp_create(char *appname, char *geometry, char **interface,
 		draw_window = iconwin;
 	}
 
+	/* create the back buffer */
+	buffer_width = win_w;
+	buffer_height = win_h;
+	back_buffer = XCreatePixmap(display, draw_window, buffer_width, buffer_height,
+	                            DefaultDepth(display, screen));
+	xgcv.graphics_exposures = False;
+	buffer_gc = XCreateGC(display, draw_window, GCGraphicsExposures, &xgcv);
+	background_pixel = whitepixel;
+
 	/* set the valuemask on the XpmAttributes structure */
 	pixattr.valuemask = 0;
 
@@ -235,8 +298,10 @@ int dockapp_create(char *appname, char *geometry, char **interface,
 	}
 	XSetWMName(display, win, &xtp);
 
-	/* create a graphics context */
-	gc = XCreateGC(display, draw_window, GCForeground | GCBackground, &xgcv);
+	/* create a graphics context, copies between pixmaps never need
+	 * GraphicsExpose/NoExpose events */
+	xgcv.graphics_exposures = False;
+	gc = XCreateGC(display, draw_window, GCForeground | GCBackground | GCGraphicsExposures, &xgcv);
 	if(!gc) {
 		fprintf(stderr, "dockapp:dockapp_create() - Couldn't create graphics context.\n");
 		return (0);
@@ -275,37 +340,33 @@ int dockapp_run() {
 	XEvent e;
 	KeySym ks;  /* JWT:NEXT 2 FOR HANDLING KEYBOARD NAVIGATION: */
 	static char buf[10], n;
-
-#ifdef USE_TOOLTIPS
-	wmappl_time_t	now;
-#endif
+	int timeout, wheel;
 
 	while(!close) {
 
-		/* sleep while there are no events pending */
+		/* block while there are no events pending */
 		while(XPending(display) == 0) {
 
 #ifdef USE_TOOLTIPS
-			if(tooltip_ptr!=NULL) {
-			        wmappl_currenttime(&now);
-				
-#if 0
-				printf ( "Delay = %d, Still = %d, Now = %d\n", tooltipDelay, still_time, now );
-
-				printf ( "TimerIsSet = %d, TimerDiff = %d\n", 
-					 wmappl_timerisset(&still_time), 
-					 wmappl_timerdiff(&still_time,&now) );
-#endif
-
-				if(wmappl_timerisset(&still_time) && wmappl_timerdiff(&still_time,&now) > tooltipDelay ) {
-				  //				        printf ( "*Debug* OK to show tooltip\n" );
-					wmappl_timerclear(&still_time);
+			/* fire the tooltip timer once it is due */
+			if((timeout = dockapp_timeout()) == 0) {
+				wmappl_timerclear(&tooltip_deadline);
+				if(tooltip_ptr!=NULL)
 					dockapp_show_tooltip(tooltip_x, tooltip_y, tooltip_ptr(tooltip_x, tooltip_y));
-				}
+				continue;
 			}
+#else
+			timeout = dockapp_timeout();
 #endif
 
-			usleep(_DELAY_TIME);
+			/* do background work before going to sleep */
+			if(idle_ptr) {
+				if(idle_ptr())
+					continue;
+				idle_ptr = NULL;
+			}
+
+			dockapp_wait(timeout);
 		}
 
 		/* process all pending events */
@@ -320,10 +381,23 @@ int dockapp_run() {
 				paint_requested = 1;
 				break;
 			case ButtonPress:
-				if(mouse_ptr)
+				if(e.xbutton.button == Button4 || e.xbutton.button == Button5) {
+					/* fold a run of wheel clicks into one net delta */
+					wheel = dockapp_compress_wheel(&e);
+					if(mouse_ptr) {
+						for(; wheel < 0; wheel++)
+							mouse_ptr(e.xbutton.x, e.xbutton.y, Button4, MOUSE_PRESSED);
+						for(; wheel > 0; wheel--)
+							mouse_ptr(e.xbutton.x, e.xbutton.y, Button5, MOUSE_PRESSED);
+					}
+				}
+				else if(mouse_ptr)
 					mouse_ptr(e.xbutton.x, e.xbutton.y, e.xbutton.button, MOUSE_PRESSED);
 
 #ifdef USE_TOOLTIPS
+				/* a click cancels a pending tooltip */
+				wmappl_timerclear(&tooltip_deadline);
+
 				/* if visible, hide tooltip */
 				if(tooltip.win) {
 					dockapp_hide_tooltip();
@@ -363,12 +437,16 @@ int dockapp_run() {
 					break;
 				}
 
-				wmappl_timerclear(&still_time);
+				/* only the latest position of a queued run matters */
+				dockapp_compress_motion(&e);
 
-				if(wmappl_currenttime(&still_time)<0) {
+				/* (re)arm the tooltip timer */
+				if(wmappl_currenttime(&tooltip_deadline)<0) {
+					wmappl_timerclear(&tooltip_deadline);
 					fprintf(stderr, "dockapp:dockapp_run() - Could not get time since epoch.\n");
 					break;
 				}
+				wmappl_timeradd(&tooltip_deadline, tooltipDelay);
 
 				tooltip_x=e.xbutton.x;
 				tooltip_y=e.xbutton.y;
@@ -385,7 +463,7 @@ int dockapp_run() {
 					break;
 				}
 
-				wmappl_timerclear(&still_time);
+				wmappl_timerclear(&tooltip_deadline);
 		
 				/* if visible, hide tooltip */
 				if(tooltip.win) {
@@ -395,33 +473,150 @@ int dockapp_run() {
 				break;
 #endif
 			case Expose:
+				if(e.xexpose.window == draw_window)
+					dockapp_damage(e.xexpose.x, e.xexpose.y, e.xexpose.width, e.xexpose.height);
 				if(e.xexpose.count != 0)
 					break;
 				paint_requested = 1;
 				break;
 			case ConfigureNotify:
+				dockapp_damage(0, 0, buffer_width, buffer_height);
 				paint_requested = 1;
 				break;
 			case DestroyNotify:
 				close = 1;
 				break;
 			}					/* switch */
-			/* call paint function if it has been requested */
-			if(paint_requested) {
-				paint_requested = 0;
-				if(paint_ptr)
-					paint_ptr(display, draw_window, gc);
+		}						/* while XPending */
+
+		/* call paint function once for the whole batch of events */
+		if(paint_requested) {
+			paint_requested = 0;
+			if(paint_ptr)
+				paint_ptr(display, back_buffer, gc);
+			dockapp_present();
 #ifdef USE_TOOLTIPS
-				if(tooltip.win)
-					dockapp_update_tooltip();
+			if(tooltip.win)
+				dockapp_update_tooltip();
 #endif
-			}
-		}						/* while XPending */
+		}
 	}							/* while not close */
 
 	return 1;
 } /* end dockapp_run */
 
+/* dockapp_compress_wheel - drains a run of queued wheel events
+ *  PARAMETERS:
+ *      XEvent *e : the wheel ButtonPress that starts the run
+ *  NOTE:
+ *      Consumes the wheel presses and releases directly following e in
+ *      the queue, stopping at the first other event so ordering with
+ *      clicks and key presses is kept.
+ *  RETURN:
+ *      int : net number of clicks, <0 is up (Button4), >0 is down
+ */
+static int dockapp_compress_wheel(XEvent *e) {
+	XEvent next;
+	int delta;
+
+	delta = (e->xbutton.button == Button4) ? -1 : 1;
+
+	while(XPending(display)) {
+		XPeekEvent(display, &next);
+		if((next.type != ButtonPress && next.type != ButtonRelease) ||
+		   (next.xbutton.button != Button4 && next.xbutton.button != Button5))
+			break;
+		XNextEvent(display, &next);
+		if(next.type == ButtonPress)
+			delta += (next.xbutton.button == Button4) ? -1 : 1;
+	}
+
+	return delta;
+}
+
+#ifdef USE_TOOLTIPS
+/* dockapp_compress_motion - skips to the last of a run of queued motion
+ *  PARAMETERS:
+ *      XEvent *e : the MotionNotify that starts the run, returns the last
+ *  NOTE:
+ *      Like dockapp_compress_wheel it stops at the first other event, so
+ *      motion after a click or a key press is still handled after it.
+ */
+static void dockapp_compress_motion(XEvent *e) {
+	XEvent next;
+
+	while(XPending(display)) {
+		XPeekEvent(display, &next);
+		if(next.type != MotionNotify || next.xmotion.window != e->xmotion.window)
+			break;
+		XNextEvent(display, e);
+	}
+}
+#endif
+
+/* dockapp_timeout
+ *  RETURN:
+ *      int : milliseconds until the next timer is due, -1 if none is
+ *            pending (suitable as a poll() timeout)
+ */
+int dockapp_timeout() {
+#ifdef USE_TOOLTIPS
+	wmappl_time_t	now;
+	long		remaining;
+
+	if(!wmappl_timerisset(&tooltip_deadline))
+		return -1;
+
+	/* the clock is only read when a timer is armed */
+	wmappl_currenttime(&now);
+	remaining = wmappl_timerleft(&now, &tooltip_deadline);
+	return remaining > 0 ? (int) remaining : 0;
+#else
+	return -1;
+#endif
+}
+
+/* dockapp_wait - blocks until the X connection is readable
+ *  PARAMETERS:
+ *      int timeout : maximum time to block in milliseconds, -1 for
+ *                    no limit
+ *  NOTE:
+ *      Descriptors registered with dockapp_add_input are watched as
+ *      well and their callbacks are called when they become readable.
+ *
+ *  RETURN:
+ *      int : >0 if a descriptor is readable, 0 on timeout, <0 on error
+ */
+int dockapp_wait(int timeout) {
+	struct pollfd	pfd[MAX_INPUTS + 1];
+	int		i, r;
+
+	pfd[0].fd = ConnectionNumber(display);
+	pfd[0].events = POLLIN;
+	pfd[0].revents = 0;
+
+	for(i = 0; i < input_count; i++) {
+		pfd[i + 1].fd = input_fd[i];
+		pfd[i + 1].events = POLLIN;
+		pfd[i + 1].revents = 0;
+	}
+
+	r = poll(pfd, input_count + 1, timeout);
+	if(r < 0) {
+		if(errno != EINTR)
+			perror("dockapp:dockapp_wait() - poll");
+		return r;
+	}
+
+	/* dispatch the additional descriptors */
+	for(i = 0; i < input_count; i++) {
+		if(pfd[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+			input_ptr[i](input_fd[i]);
+	}
+
+	return r;
+}
+
 /* dockapp_redraw - requests that the paint function be called
  *  PARAMETERS:
  *      none
@@ -432,14 +627,150 @@ void dockapp_redraw() {
 	paint_requested = 1;
 }
 
-/* dockapp_clear - clears the draw window
+/* dockapp_clear - clears the back buffer to the background
  *  PARAMETERS:
  *      none
  *  RETURN:
  *      none
  */
 void dockapp_clear() {
-	XClearWindow(display, draw_window);
+	dockapp_draw_background(back_buffer, 0, 0, buffer_width, buffer_height, 0, 0);
+	dockapp_damage(0, 0, buffer_width, buffer_height);
+}
+
+/* dockapp_copy_area - moves pixels inside the back buffer
+ *  PARAMETERS:
+ *      int src_x, src_y  : position of the area to copy
+ *      unsigned int w, h : size of the area
+ *      int dst_x, dst_y  : position to copy the area to
+ *  RETURN:
+ *      none
+ */
+void dockapp_copy_area(int src_x, int src_y, unsigned int w, unsigned int h,
+                       int dst_x, int dst_y) {
+	XCopyArea(display, back_buffer, back_buffer, buffer_gc, src_x, src_y, w, h, dst_x, dst_y);
+	dockapp_damage(dst_x, dst_y, w, h);
+}
+
+/* dockapp_damage - marks an area of the back buffer as changed
+ *  PARAMETERS:
+ *      int x, y          : position of the changed area
+ *      unsigned int w, h : size of the changed area
+ *  RETURN:
+ *      none
+ */
+void dockapp_damage(int x, int y, unsigned int w, unsigned int h) {
+	if(!damaged) {
+		damage_x1 = x;
+		damage_y1 = y;
+		damage_x2 = x + w;
+		damage_y2 = y + h;
+		damaged = 1;
+		return;
+	}
+	if(x < damage_x1) damage_x1 = x;
+	if(y < damage_y1) damage_y1 = y;
+	if(x + (int) w > damage_x2) damage_x2 = x + w;
+	if(y + (int) h > damage_y2) damage_y2 = y + h;
+}
+
+/* dockapp_draw_background - draws the background into a drawable
+ *  PARAMETERS:
+ *      Drawable drw   : drawable to draw into
+ *      int x, y       : position in drw
+ *      unsigned int w, h : size of the area
+ *      int win_x, win_y  : position in the draw window whose background
+ *                          should appear at x, y
+ *  RETURN:
+ *      none
+ */
+void dockapp_draw_background(Drawable drw, int x, int y, unsigned int w, unsigned int h,
+                             int win_x, int win_y) {
+	if(background_pixmap != None) {
+		XSetFillStyle(display, buffer_gc, FillTiled);
+		XSetTile(display, buffer_gc, background_pixmap);
+		XSetTSOrigin(display, buffer_gc, x - win_x, y - win_y);
+	}
+	else {
+		XSetFillStyle(display, buffer_gc, FillSolid);
+		XSetForeground(display, buffer_gc, background_pixel);
+	}
+	XFillRectangle(display, drw, buffer_gc, x, y, w, h);
+}
+
+/* dockapp_background_serial
+ *  RETURN:
+ *      unsigned long : changes every time the background is changed
+ */
+unsigned long dockapp_background_serial() {
+	return background_serial;
+}
+
+/* dockapp_background_uniform - tells whether the background is a single
+ *                              color over an area of the draw window
+ *  PARAMETERS:
+ *      int x, y          : position in the draw window
+ *      unsigned int w, h : size of the area
+ *  RETURN:
+ *      int : nonzero if every pixel of the area is the same
+ */
+int dockapp_background_uniform(int x, int y, unsigned int w, unsigned int h) {
+	XImage *image;
+	Window root;
+	int px, py;
+	unsigned int pw, ph, border, depth, i, j;
+	unsigned long first;
+
+	if(background_pixmap == None)
+		return 1;
+
+	if(uniform_serial == background_serial && uniform_x == x && uniform_y == y &&
+	   uniform_w == w && uniform_h == h)
+		return uniform_result;
+	uniform_serial = background_serial;
+	uniform_x = x;
+	uniform_y = y;
+	uniform_w = w;
+	uniform_h = h;
+	uniform_result = 0;
+
+	if(x < 0 || y < 0 ||
+	   !XGetGeometry(display, background_pixmap, &root, &px, &py, &pw, &ph, &border, &depth))
+		return 0;
+	image = XGetImage(display, background_pixmap, 0, 0, pw, ph, AllPlanes, ZPixmap);
+	if(image == NULL)
+		return 0;
+
+	/* the pixmap is tiled from the origin of the draw window */
+	first = XGetPixel(image, x % pw, y % ph);
+	uniform_result = 1;
+	for(j = 0; j < h && uniform_result; j++) {
+		for(i = 0; i < w; i++) {
+			if(XGetPixel(image, (x + i) % pw, (y + j) % ph) != first) {
+				uniform_result = 0;
+				break;
+			}
+		}
+	}
+	XDestroyImage(image);
+
+	return uniform_result;
+}
+
+/* dockapp_present - copies the damaged part of the back buffer to the
+ *                   draw window
+ *  PARAMETERS:
+ *      none
+ *  RETURN:
+ *      none
+ */
+void dockapp_present() {
+	if(!damaged)
+		return;
+	XCopyArea(display, back_buffer, draw_window, buffer_gc,
+	          damage_x1, damage_y1, damage_x2 - damage_x1, damage_y2 - damage_y1,
+	          damage_x1, damage_y1);
+	damaged = 0;
 }
 
 /* dockapp_set_paint
@@ -485,6 +816,36 @@ int dockapp_set_keyboard(void (*func) (char kc, KeySym ks, int s)) {
 	return 0;
 }
 
+/* dockapp_set_idle
+ *	PARAMETERS:
+ *		int (*func)() : pointer to idle function
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_set_idle(int (*func) (void)) {
+	if(func) {
+		idle_ptr = func;
+		return 1;
+	}
+	return 0;
+}
+
+/* dockapp_add_input
+ *	PARAMETERS:
+ *		int fd               : descriptor to watch for input
+ *		void (*func)(int fd) : called from the event loop when fd is readable
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_add_input(int fd, void (*func) (int fd)) {
+	if(fd < 0 || !func || input_count >= MAX_INPUTS)
+		return 0;
+	input_fd[input_count] = fd;
+	input_ptr[input_count] = func;
+	input_count++;
+	return 1;
+}
+
 /* dockapp_init_display
  *
  * RETURN: status. <0 on error, 0 when OK
@@ -496,6 +857,8 @@ int  dockapp_init_display(void) {
     fprintf(stderr, "dockapp:dockapp_init_display() - Couldn't connect to display.\n");
     return -1;
   }
+  /* launched commands must not inherit the X connection */
+  fcntl(ConnectionNumber(display), F_SETFD, FD_CLOEXEC);
   return 0;
 }
 
@@ -533,6 +896,137 @@ unsigned long dockapp_white_pixel() {
 
 }
 
+/* truecolor_component - scales a 16 bit color component into a mask */
+static unsigned long truecolor_component(unsigned short value, unsigned long mask) {
+	int shift = 0, bits = 0;
+
+	if(!mask)
+		return 0;
+	while(!(mask & 1)) {
+		mask >>= 1;
+		shift++;
+	}
+	while(mask & 1) {
+		mask >>= 1;
+		bits++;
+	}
+	if(bits > 16)
+		bits = 16;
+
+	return ((unsigned long) value >> (16 - bits)) << shift;
+}
+
+/* lookup_color - returns the cache entry for color, resolving it if needed */
+static CachedColor *lookup_color(char *color) {
+	CachedColor *c;
+	XColor xcolor;
+	Visual *visual = DefaultVisual(display, dockapp_get_screen());
+	Colormap colormap = XDefaultColormap(display, dockapp_get_screen());
+	unsigned int h = 5381;
+	size_t i, len = strlen(color);
+
+	for(i = 0; i < len; i++)
+		h = h * 33 + tolower((unsigned char) color[i]);
+	h &= COLOR_CACHE_SIZE - 1;
+
+	for(c = color_cache[h]; c != NULL; c = c->next) {
+		if(strcasecmp(c->spec, color) == 0)
+			return c;
+	}
+
+	c = (CachedColor *) malloc(sizeof(CachedColor) + len);
+	if(!c) {
+		fprintf(stderr, "dockapp:dockapp_alloc_color() - Couldn't allocate memory.\n");
+		return NULL;
+	}
+	for(i = 0; i <= len; i++)
+		c->spec[i] = tolower((unsigned char) color[i]);
+	c->pixel = BlackPixel(display, dockapp_get_screen());
+	c->rgb = 0;
+	c->valid = 0;
+
+	/* numeric specs are parsed locally, only names need the server */
+	if(XParseColor(display, colormap, color, &xcolor)==0) {
+		fprintf(stderr, "Could not parse color: %s\n", color);
+	}
+	else {
+		c->rgb = (xcolor.red >> 8) << 16 | (xcolor.green >> 8) << 8 | xcolor.blue >> 8;
+		if(visual->class == TrueColor) {
+			c->pixel = truecolor_component(xcolor.red, visual->red_mask) |
+			           truecolor_component(xcolor.green, visual->green_mask) |
+			           truecolor_component(xcolor.blue, visual->blue_mask);
+			c->valid = 1;
+		}
+		else if(XAllocColor(display, colormap, &xcolor)==0) {
+			fprintf(stderr, "Could not allocate color: %s\n", color);
+		}
+		else {
+			c->pixel = xcolor.pixel;
+			c->valid = 1;
+		}
+	}
+
+	c->next = color_cache[h];
+	color_cache[h] = c;
+
+	return c;
+}
+
+/* dockapp_alloc_color
+ *  PARAMETERS:
+ *	  char *color          : color name or numeric spec
+ *	  unsigned long *pixel : returns the pixel value
+ *  RETURN:
+ *	  int : returns non-zero on success
+ */
+int dockapp_alloc_color(char *color, unsigned long *pixel) {
+	CachedColor *c = lookup_color(color);
+
+	if(!c) {
+		*pixel = BlackPixel(display, dockapp_get_screen());
+		return 0;
+	}
+	*pixel = c->pixel;
+	return c->valid;
+}
+
+/* dockapp_color_rgb
+ *  PARAMETERS:
+ *	  char *color       : color name or numeric spec
+ *	  unsigned int *rgb : returns the color as 0xRRGGBB
+ *  RETURN:
+ *	  int : returns non-zero on success
+ */
+int dockapp_color_rgb(char *color, unsigned int *rgb) {
+	CachedColor *c = lookup_color(color);
+
+	*rgb = c ? c->rgb : 0;
+	return c && c->valid;
+}
+
+/* dockapp_rgb_pixel
+ *  PARAMETERS:
+ *	  unsigned int rgb : color as 0xRRGGBB
+ *  RETURN:
+ *	  unsigned long : pixel value, black if it can't be allocated
+ */
+unsigned long dockapp_rgb_pixel(unsigned int rgb) {
+	Visual *visual = DefaultVisual(display, dockapp_get_screen());
+	unsigned long pixel;
+	char spec[8];
+
+	if(visual->class == TrueColor) {
+		return truecolor_component((rgb >> 16 & 0xff) * 0x101, visual->red_mask) |
+		       truecolor_component((rgb >> 8 & 0xff) * 0x101, visual->green_mask) |
+		       truecolor_component((rgb & 0xff) * 0x101, visual->blue_mask);
+	}
+
+	/* other visuals share the cache of allocated colors */
+	sprintf(spec, "#%06x", rgb & 0xffffff);
+	dockapp_alloc_color(spec, &pixel);
+	return pixel;
+}
+
 /* dockapp_to_screen_coords
  *   PARAMETERS:
  *     int x             : x coordinate relative to origin of draw_window
@@ -557,18 +1051,11 @@ int dockapp_to_screen_coords(int x, int y, int *x_return, int *y_return) {
  *
  */
 void dockapp_set_background_color(char *color) {
-	XColor xcolor;
-	Colormap colormap = XDefaultColormap(display, dockapp_get_screen());
+	unsigned long pixel;
 
-	if(XParseColor(display, colormap, color, &xcolor)==0) {
-		fprintf(stderr, "Could not parse color: %s\n", color);
-		return;
-	}
-	if(XAllocColor(display, colormap, &xcolor)==0) {
-		fprintf(stderr, "Could not allocate color: %s\n", color);
+	if(!dockapp_alloc_color(color, &pixel))
 		return;
-	}
-	dockapp_set_background_pixel(xcolor.pixel);
+	dockapp_set_background_pixel(pixel);
 }
 
 /* dockapp_set_background_pixel
@@ -578,7 +1065,11 @@ void dockapp_set_background_color(char *color) {
  */
 void dockapp_set_background_pixel(unsigned long pixel) {
 	XSetWindowBackground(display, draw_window, pixel);
+	background_pixmap = None;
+	background_pixel = pixel;
+	background_serial++;
 	dockapp_clear();
+	dockapp_redraw();
 }
 
 /* dockapp_set_background_pixmap_data
@@ -614,7 +1105,7 @@ void dockapp_set_background_pixmap_file(char *file) {
 	pixattr.valuemask = 0;
 
 	/* load pixmap */
-	create_button_pixmap(display, file, &pixmap, &pixmask, &pixattr);
+	create_button_pixmap(display, file, 0, &pixmap, &pixmask, &pixattr, NULL, NULL);
 
 	dockapp_set_background_pixmap(pixmap);
 }
@@ -626,7 +1117,10 @@ void dockapp_set_background_pixmap_file(char *file) {
  */
 void dockapp_set_background_pixmap(Pixmap pixmap) {
 	XSetWindowBackgroundPixmap(display, draw_window, pixmap);
+	background_pixmap = pixmap;
+	background_serial++;
 	dockapp_clear();
+	dockapp_redraw();
 }
 
 #ifdef USE_TOOLTIPS
@@ -637,18 +1131,11 @@ void dockapp_set_background_pixmap(Pixmap pixmap) {
  *
  */
 void dockapp_set_tooltip_foreground(char *color) {
-	XColor xcolor;
-	Colormap colormap = XDefaultColormap(display, dockapp_get_screen());
+	unsigned long pixel;
 
-	if(XParseColor(display, colormap, color, &xcolor)==0) {
-		fprintf(stderr, "Could not parse color: %s\n", color);
-		return;
-	}
-	if(XAllocColor(display, colormap, &xcolor)==0) {
-		fprintf(stderr, "Could not allocate color: %s\n", color);
+	if(!dockapp_alloc_color(color, &pixel))
 		return;
-	}
-	tooltip_fg=xcolor.pixel;
+	tooltip_fg=pixel;
 }
 
 /* dockapp_set_tooltip_background
@@ -657,18 +1144,11 @@ void dockapp_set_tooltip_foreground(char *color) {
  *
  */
 void dockapp_set_tooltip_background(char *color) {
-	XColor xcolor;
-	Colormap colormap = XDefaultColormap(display, dockapp_get_screen());
+	unsigned long pixel;
 
-	if(XParseColor(display, colormap, color, &xcolor)==0) {
-		fprintf(stderr, "Could not parse color: %s\n", color);
+	if(!dockapp_alloc_color(color, &pixel))
 		return;
-	}
-	if(XAllocColor(display, colormap, &xcolor)==0) {
-		fprintf(stderr, "Could not allocate color: %s\n", color);
-		return;
-	}
-	tooltip_bg=xcolor.pixel;
+	tooltip_bg=pixel;
 }
 
 /* dockapp_set_tooltip
@@ -12,7 +12,10 @@
  *   events. If more information is needed, the get_XXXXXX calls provide
  *   some additional information. The clear_window and request_paint
  *   functions may also be called from the callbacks to clear the draw
- *   window or request that the paint callback be called.
+ *   window or request that the paint callback be called. The paint
+ *   callback draws into an off-screen buffer and reports the areas it
+ *   changed with dockapp_damage; once it returns the changed part of the
+ *   buffer is copied to the window in a single request.
  *
  *   For information or for updates to these libraries check:
  *       http://www.pobox.com/~charkins/dockapp.html
@@ -45,9 +48,6 @@
 #include <string.h>
 
 
-/* time to wait till the next XPending */
-#define _DELAY_TIME	100000
-
 /* MOUSE MACROS */
 #define MOUSE_PRESSED  1
 #define MOUSE_RELEASED 0
@@ -87,6 +87,26 @@ int dockapp_create(char *appname, char *geometry, char **interface,
  */
 int dockapp_run();
 
+/* dockapp_timeout
+ *  RETURN:
+ *      int : milliseconds until the next timer is due, -1 if none is
+ *            pending (suitable as a poll() timeout)
+ */
+int dockapp_timeout();
+
+/* dockapp_wait - blocks until the X connection is readable
+ *  PARAMETERS:
+ *      int timeout : maximum time to block in milliseconds, -1 for
+ *                    no limit
+ *  NOTE:
+ *      Descriptors registered with dockapp_add_input are watched as
+ *      well and their callbacks are called when they become readable.
+ *
+ *  RETURN:
+ *      int : >0 if a descriptor is readable, 0 on timeout, <0 on error
+ */
+int dockapp_wait(int timeout);
+
 /* dockapp_redraw - requests that the paint function be called
  *  PARAMETERS:
  *      none
@@ -95,7 +115,7 @@ int dockapp_run();
  */
 void dockapp_redraw();
 
-/* dockapp_clear - clears the draw window
+/* dockapp_clear - clears the back buffer to the background
  *  PARAMETERS:
  *      none
  *  RETURN:
@@ -103,6 +123,66 @@ void dockapp_redraw();
  */
 void dockapp_clear();
 
+/* dockapp_draw_background - draws the background into a drawable
+ *  PARAMETERS:
+ *      Drawable drw   : drawable to draw into
+ *      int x, y       : position in drw
+ *      unsigned int w, h : size of the area
+ *      int win_x, win_y  : position in the draw window whose background
+ *                          should appear at x, y
+ *  RETURN:
+ *      none
+ */
+void dockapp_draw_background(Drawable drw, int x, int y, unsigned int w, unsigned int h,
+                             int win_x, int win_y);
+
+/* dockapp_background_serial
+ *  RETURN:
+ *      unsigned long : changes every time the background is changed
+ */
+unsigned long dockapp_background_serial();
+
+/* dockapp_background_uniform - tells whether the background is a single
+ *                              color over an area of the draw window
+ *  PARAMETERS:
+ *      int x, y          : position in the draw window
+ *      unsigned int w, h : size of the area
+ *  NOTE:
+ *      A background pixmap is read back once per area and background.
+ *  RETURN:
+ *      int : nonzero if every pixel of the area is the same
+ */
+int dockapp_background_uniform(int x, int y, unsigned int w, unsigned int h);
+
+/* dockapp_copy_area - moves pixels inside the back buffer
+ *  PARAMETERS:
+ *      int src_x, src_y  : position of the area to copy
+ *      unsigned int w, h : size of the area
+ *      int dst_x, dst_y  : position to copy the area to
+ *  RETURN:
+ *      none
+ */
+void dockapp_copy_area(int src_x, int src_y, unsigned int w, unsigned int h,
+                       int dst_x, int dst_y);
+
+/* dockapp_damage - marks an area of the back buffer as changed
+ *  PARAMETERS:
+ *      int x, y          : position of the changed area
+ *      unsigned int w, h : size of the changed area
+ *  RETURN:
+ *      none
+ */
+void dockapp_damage(int x, int y, unsigned int w, unsigned int h);
+
+/* dockapp_present - copies the damaged part of the back buffer to the
+ *                   draw window
+ *  PARAMETERS:
+ *      none
+ *  RETURN:
+ *      none
+ */
+void dockapp_present();
+
 /* dockapp_set_paint
  *	PARAMETERS:
  *		void (*func)(Display *dsp, Drawable drw, GC g) : pointer to paint 
@@ -128,6 +208,25 @@ int dockapp_set_mouse(	void (*func)(int x, int y, int b, int s));
  */
 int dockapp_set_keyboard(void (*func) (char kc, KeySym ks, int s));
 
+/* dockapp_set_idle
+ *	PARAMETERS:
+ *		int (*func)() : pointer to idle function, called whenever no
+ *		                events are pending until it returns zero; it
+ *		                should do one small piece of work per call
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_set_idle(int (*func) (void));
+
+/* dockapp_add_input
+ *	PARAMETERS:
+ *		int fd               : descriptor to watch for input
+ *		void (*func)(int fd) : called from the event loop when fd is readable
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_add_input(int fd, void (*func) (int fd));
+
 /* dockapp_init_display
  *
  * RETURN: status. <0 on error, 0 when OK
@@ -158,6 +257,40 @@ unsigned long dockapp_black_pixel();
  */
 unsigned long dockapp_white_pixel();
 
+/* dockapp_alloc_color
+ *	PARAMETERS:
+ *		char *color          : color name or numeric spec (#rrggbb, rgb:r/g/b)
+ *		unsigned long *pixel : returns the pixel value
+ *	NOTE:
+ *		Results are cached by spec, so each color costs at most one
+ *		round trip (for looking up a name) for the whole program. On
+ *		TrueColor visuals the pixel value is computed from the visual's
+ *		masks instead of calling XAllocColor.
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_alloc_color(char *color, unsigned long *pixel);
+
+/* dockapp_color_rgb
+ *	PARAMETERS:
+ *		char *color       : color name or numeric spec
+ *		unsigned int *rgb : returns the color as 0xRRGGBB
+ *	NOTE:
+ *		Shares the cache of dockapp_alloc_color.
+ *	RETURN:
+ *		int : returns non-zero on success
+ */
+int dockapp_color_rgb(char *color, unsigned int *rgb);
+
+/* dockapp_rgb_pixel
+ *	PARAMETERS:
+ *		unsigned int rgb : color as 0xRRGGBB
+ *	RETURN:
+ *		unsigned long : pixel value, computed locally on TrueColor
+ *		                visuals, black if it can't be allocated
+ */
+unsigned long dockapp_rgb_pixel(unsigned int rgb);
+
 /* dockapp_to_screen_coords
  *   PARAMETERS:
  *     int x             : x coordinate relative to origin of draw_window
@@ -0,0 +1,560 @@
+/* iconcache.c
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "iconcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <X11/Xutil.h>
+
+/* the file starts with this header, followed by count records */
+#define CACHE_MAGIC	"WMAPICO3"
+#define CACHE_ALIGN	8
+#define cache_align(n)	(((n) + CACHE_ALIGN - 1) & ~(size_t) (CACHE_ALIGN - 1))
+#define ENTRY_BUCKETS	256
+
+/* layout of the pixel data, the cache is only valid for the same one */
+typedef struct {
+	char     magic[8];
+	uint32_t count;
+	uint32_t depth;
+	uint64_t red_mask, green_mask, blue_mask;
+	uint32_t byte_order, bitmap_bit_order, bitmap_unit, bitmap_pad;
+} CacheHeader;
+
+/* one icon, followed by its path, ZPixmap data and XYPixmap mask data,
+ * each starting on a CACHE_ALIGN boundary */
+typedef struct {
+	uint32_t size;			/* whole record including the data */
+	uint32_t path_length;		/* including the terminating NUL */
+	int64_t  file_size;
+	int64_t  file_mtime, file_mtime_ns;	/* nanoseconds too, so a rewrite */
+	int64_t  file_ctime, file_ctime_ns;	/* within the second still shows */
+	int32_t  width, height;
+	int32_t  bits_per_pixel;
+	int32_t  bytes_per_line;
+	int32_t  mask_bytes_per_line;	/* 0 if the icon has no mask */
+	int32_t  reserved;
+} CacheRecord;
+
+typedef struct {
+	CacheRecord rec;
+	char *path;
+	char *pixels;
+	char *mask;
+	int used;			/* loaded or stored this session */
+	int owned;			/* data is malloc'ed, not mapped */
+	int next;			/* next entry in the same bucket, -1 ends */
+} CacheEntry;
+
+static int cache_state = 0;		/* 0 not opened, 1 open, <0 disabled */
+static int cache_dirty = 0;
+static CacheHeader format;		/* layout used by this display */
+static Visual *visual;
+static void *cache_map = NULL;
+static size_t cache_map_size = 0;
+static CacheEntry *entries = NULL;
+static int entry_count = 0, entry_alloc = 0;
+static int entry_index[ENTRY_BUCKETS];	/* first entry of each bucket, -1 if none */
+static int entry_index_ready = 0;
+static GC pixmap_gc = None, mask_gc = None;
+static char cache_path[4096];
+
+/* cache_entry - adds an empty entry */
+static CacheEntry *cache_entry(void)
+{
+	CacheEntry *grown;
+
+	if(entry_count == entry_alloc) {
+		entry_alloc = entry_alloc ? entry_alloc * 2 : 64;
+		grown = (CacheEntry *) realloc(entries, entry_alloc * sizeof(CacheEntry));
+		if(!grown) {
+			fprintf(stderr, "iconcache.c: Couldn't allocate cache entries.\n");
+			exit(1);
+		}
+		entries = grown;
+	}
+
+	memset(&entries[entry_count], 0, sizeof(CacheEntry));
+	return &entries[entry_count++];
+}
+
+/* cache_stamp - records what st says about the file of rec */
+static void cache_stamp(CacheRecord *rec, struct stat *st)
+{
+	rec->file_size = st->st_size;
+	rec->file_mtime = st->st_mtim.tv_sec;
+	rec->file_mtime_ns = st->st_mtim.tv_nsec;
+	rec->file_ctime = st->st_ctim.tv_sec;
+	rec->file_ctime_ns = st->st_ctim.tv_nsec;
+}
+
+/* cache_current - nonzero if rec was made from the file of st as it is */
+static int cache_current(CacheRecord *rec, struct stat *st)
+{
+	return rec->file_size == (int64_t) st->st_size &&
+	       rec->file_mtime == (int64_t) st->st_mtim.tv_sec && rec->file_mtime_ns == (int64_t) st->st_mtim.tv_nsec &&
+	       rec->file_ctime == (int64_t) st->st_ctim.tv_sec && rec->file_ctime_ns == (int64_t) st->st_ctim.tv_nsec;
+}
+
+/* cache_hash - string hash for the entry index */
+static unsigned int cache_hash(const char *s)
+{
+	unsigned int h = 5381;
+
+	while(*s)
+		h = h * 33 + (unsigned char) *s++;
+
+	return h;
+}
+
+/* cache_index - adds an entry whose path is set to the index, entries
+ * are linked by position as the array moves when it grows */
+static void cache_index(CacheEntry *e)
+{
+	unsigned int bucket = cache_hash(e->path) & (ENTRY_BUCKETS - 1);
+	int i;
+
+	if(!entry_index_ready) {
+		for(i = 0; i < ENTRY_BUCKETS; i++)
+			entry_index[i] = -1;
+		entry_index_ready = 1;
+	}
+
+	e->next = entry_index[bucket];
+	entry_index[bucket] = e - entries;
+}
+
+/* cache_find - finds the entry for path, NULL if there is none */
+static CacheEntry *cache_find(char *path)
+{
+	int i;
+
+	if(!entry_index_ready)
+		return NULL;
+
+	for(i = entry_index[cache_hash(path) & (ENTRY_BUCKETS - 1)]; i >= 0; i = entries[i].next) {
+		if(strcmp(entries[i].path, path) == 0)
+			return &entries[i];
+	}
+
+	return NULL;
+}
+
+/* cache_map_file - maps the cache file and indexes its records, a file
+ * written for another display layout is simply ignored */
+static void cache_map_file(void)
+{
+	CacheHeader *header;
+	CacheRecord *rec;
+	CacheEntry *e;
+	struct stat st;
+	size_t offset, pixel_size, mask_size;
+	unsigned int i;
+	int fd;
+
+	fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		cache_dirty = 1;
+		return;
+	}
+
+	if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(CacheHeader)) {
+		close(fd);
+		cache_dirty = 1;
+		return;
+	}
+
+	cache_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(cache_map == MAP_FAILED) {
+		cache_map = NULL;
+		cache_dirty = 1;
+		return;
+	}
+	cache_map_size = st.st_size;
+
+	header = (CacheHeader *) cache_map;
+	format.count = header->count;
+	if(memcmp(header, &format, sizeof(CacheHeader)) != 0) {
+		cache_dirty = 1;
+		return;
+	}
+
+	offset = cache_align(sizeof(CacheHeader));
+	for(i = 0; i < header->count; i++) {
+		if(offset + sizeof(CacheRecord) > cache_map_size)
+			break;
+		rec = (CacheRecord *) ((char *) cache_map + offset);
+
+		/* give up on anything that doesn't fit the record */
+		pixel_size = (size_t) rec->bytes_per_line * rec->height;
+		mask_size = (size_t) rec->mask_bytes_per_line * rec->height;
+		if(rec->width <= 0 || rec->height <= 0 || rec->path_length == 0 ||
+		   rec->size > cache_map_size - offset ||
+		   cache_align(sizeof(CacheRecord)) + cache_align(rec->path_length) +
+		   cache_align(pixel_size) + cache_align(mask_size) > rec->size ||
+		   ((char *) rec)[cache_align(sizeof(CacheRecord)) + rec->path_length - 1] != '\0')
+			break;
+
+		e = cache_entry();
+		e->rec = *rec;
+		e->path = (char *) rec + cache_align(sizeof(CacheRecord));
+		e->pixels = e->path + cache_align(rec->path_length);
+		e->mask = rec->mask_bytes_per_line ? e->pixels + cache_align(pixel_size) : NULL;
+		cache_index(e);
+
+		offset += rec->size;
+	}
+
+	if(i != header->count)
+		cache_dirty = 1;
+}
+
+/* cache_open - sets up the cache on first use */
+static int cache_open(Display *display)
+{
+	char *dir;
+	int screen;
+
+	if(cache_state != 0)
+		return cache_state;
+	cache_state = -1;
+
+	/* pixel values of other visuals depend on the colormap */
+	screen = DefaultScreen(display);
+	visual = DefaultVisual(display, screen);
+	if(visual->class != TrueColor)
+		return cache_state;
+
+	if((dir = getenv("XDG_CACHE_HOME")) != NULL && dir[0] == '/') {
+		if(snprintf(cache_path, sizeof(cache_path), "%s/wmappl/icons", dir) >= (int) sizeof(cache_path))
+			return cache_state;
+	}
+	else if((dir = getenv("HOME")) != NULL) {
+		if(snprintf(cache_path, sizeof(cache_path), "%s/.cache/wmappl/icons", dir) >= (int) sizeof(cache_path))
+			return cache_state;
+	}
+	else {
+		return cache_state;
+	}
+
+	memset(&format, 0, sizeof(format));
+	memcpy(format.magic, CACHE_MAGIC, sizeof(format.magic));
+	format.depth = DefaultDepth(display, screen);
+	format.red_mask = visual->red_mask;
+	format.green_mask = visual->green_mask;
+	format.blue_mask = visual->blue_mask;
+	format.byte_order = ImageByteOrder(display);
+	format.bitmap_bit_order = BitmapBitOrder(display);
+	format.bitmap_unit = BitmapUnit(display);
+	format.bitmap_pad = BitmapPad(display);
+
+	cache_map_file();
+
+	cache_state = 1;
+	return cache_state;
+}
+
+/* iconcache_contains
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *  RETURN:
+ *      int : nonzero if iconcache_load would hit
+ */
+int iconcache_contains(Display *display, char *filename, struct stat *st)
+{
+	CacheEntry *e;
+
+	if(filename[0] != '/' || cache_open(display) < 0)
+		return 0;
+
+	e = cache_find(filename);
+	return e != NULL && cache_current(&e->rec, st);
+}
+
+/* iconcache_load
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *      Pixmap *pixmap      : returns the icon
+ *      Pixmap *pixmask     : returns the mask, None if opaque
+ *      int *width, *height : returns the size of the icon
+ *  RETURN:
+ *      int : 0 on a hit, <0 if the icon has to be decoded
+ */
+int iconcache_load(Display *display, char *filename, struct stat *st,
+                   Pixmap *pixmap, Pixmap *pixmask, int *width, int *height)
+{
+	CacheEntry *e;
+	XImage *image, *mask = NULL;
+	Window root;
+
+	if(filename[0] != '/' || cache_open(display) < 0)
+		return -1;
+
+	e = cache_find(filename);
+	if(e == NULL)
+		return -1;
+
+	/* a changed file is decoded again and replaces the entry */
+	if(!cache_current(&e->rec, st)) {
+		cache_dirty = 1;
+		return -1;
+	}
+
+	/* rows are as long as recorded, the pad of 8 only sets their minimum */
+	image = XCreateImage(display, visual, format.depth, ZPixmap, 0, e->pixels,
+	                     e->rec.width, e->rec.height, 8, e->rec.bytes_per_line);
+	if(image == NULL)
+		return -1;
+	if(image->bits_per_pixel != e->rec.bits_per_pixel) {
+		image->data = NULL;
+		XDestroyImage(image);
+		return -1;
+	}
+
+	if(e->mask) {
+		mask = XCreateImage(display, visual, 1, XYPixmap, 0, e->mask,
+		                    e->rec.width, e->rec.height, 8, e->rec.mask_bytes_per_line);
+		if(mask == NULL) {
+			image->data = NULL;
+			XDestroyImage(image);
+			return -1;
+		}
+	}
+
+	root = RootWindow(display, DefaultScreen(display));
+
+	*pixmap = XCreatePixmap(display, root, e->rec.width, e->rec.height, format.depth);
+	if(pixmap_gc == None)
+		pixmap_gc = XCreateGC(display, *pixmap, 0, NULL);
+	XPutImage(display, *pixmap, pixmap_gc, image, 0, 0, 0, 0, e->rec.width, e->rec.height);
+
+	*pixmask = None;
+	if(mask) {
+		*pixmask = XCreatePixmap(display, root, e->rec.width, e->rec.height, 1);
+		if(mask_gc == None)
+			mask_gc = XCreateGC(display, *pixmask, 0, NULL);
+		XPutImage(display, *pixmask, mask_gc, mask, 0, 0, 0, 0, e->rec.width, e->rec.height);
+		/* the data belongs to the cache */
+		mask->data = NULL;
+		XDestroyImage(mask);
+	}
+
+	image->data = NULL;
+	XDestroyImage(image);
+
+	*width = e->rec.width;
+	*height = e->rec.height;
+	e->used = 1;
+
+	return 0;
+}
+
+/* iconcache_store
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *      XImage *image       : ZPixmap the icon was uploaded from
+ *      XImage *mask        : XYPixmap of its mask, NULL if opaque
+ */
+void iconcache_store(Display *display, char *filename, struct stat *st,
+                     XImage *image, XImage *mask)
+{
+	CacheEntry *e;
+	size_t pixel_size, mask_size;
+	int width = image->width, height = image->height, fresh;
+
+	if(filename[0] != '/' || cache_open(display) < 0)
+		return;
+
+	/* only images laid out the way the cache header says */
+	if(image->format != ZPixmap || image->depth != (int) format.depth ||
+	   image->byte_order != (int) format.byte_order ||
+	   (mask && (mask->format != XYPixmap || mask->depth != 1 ||
+	             mask->width != width || mask->height != height ||
+	             mask->byte_order != (int) format.byte_order ||
+	             mask->bitmap_bit_order != (int) format.bitmap_bit_order ||
+	             mask->bitmap_unit != (int) format.bitmap_unit)))
+		return;
+
+	pixel_size = (size_t) image->bytes_per_line * height;
+	mask_size = mask ? (size_t) mask->bytes_per_line * height : 0;
+
+	/* replace a stale entry, its mapped data is left alone */
+	e = cache_find(filename);
+	fresh = e == NULL;
+	if(fresh) {
+		e = cache_entry();
+	}
+	else if(e->owned) {
+		free(e->path);
+	}
+
+	e->rec.path_length = strlen(filename) + 1;
+	cache_stamp(&e->rec, st);
+	e->rec.width = width;
+	e->rec.height = height;
+	e->rec.bits_per_pixel = image->bits_per_pixel;
+	e->rec.bytes_per_line = image->bytes_per_line;
+	e->rec.mask_bytes_per_line = mask ? mask->bytes_per_line : 0;
+	e->rec.reserved = 0;
+	e->rec.size = cache_align(sizeof(CacheRecord)) + cache_align(e->rec.path_length) +
+	              cache_align(pixel_size) + cache_align(mask_size);
+
+	/* path and data share one allocation */
+	e->path = (char *) malloc(e->rec.size);
+	if(!e->path) {
+		fprintf(stderr, "iconcache.c: Couldn't allocate cache entry.\n");
+		exit(1);
+	}
+	memcpy(e->path, filename, e->rec.path_length);
+	if(fresh)
+		cache_index(e);
+	e->pixels = e->path + cache_align(e->rec.path_length);
+	memcpy(e->pixels, image->data, pixel_size);
+	e->mask = NULL;
+	if(mask) {
+		e->mask = e->pixels + cache_align(pixel_size);
+		memcpy(e->mask, mask->data, mask_size);
+	}
+
+	e->used = 1;
+	e->owned = 1;
+	cache_dirty = 1;
+}
+
+/* cache_write - writes size bytes and pads them up to CACHE_ALIGN */
+static int cache_write(FILE *f, const void *data, size_t size)
+{
+	static const char zero[CACHE_ALIGN];
+
+	if(size > 0 && fwrite(data, size, 1, f) != 1)
+		return -1;
+	if(cache_align(size) != size && fwrite(zero, cache_align(size) - size, 1, f) != 1)
+		return -1;
+	return 0;
+}
+
+/* cache_mkdir - creates the directories leading to the cache file */
+static int cache_mkdir(char *path)
+{
+	char *p;
+
+	for(p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		if(mkdir(path, 0700) < 0 && errno != EEXIST) {
+			*p = '/';
+			return -1;
+		}
+		*p = '/';
+	}
+
+	return 0;
+}
+
+/* iconcache_save
+ *  NOTE:
+ *      Rewrites the cache file if anything was decoded or the file of an
+ *      unused entry changed or went away, so stale icons drop out. Unused
+ *      entries of unchanged files are kept, they may simply not have
+ *      been loaded this time.
+ */
+void iconcache_save(void)
+{
+	CacheHeader header;
+	struct stat st;
+	char temp[sizeof(cache_path) + 8];
+	FILE *f;
+	int i, fd, error = 0;
+
+	if(cache_state != 1)
+		return;
+
+	/* keep the unused entries that are still valid, drop the rest */
+	for(i = 0; i < entry_count; i++) {
+		if(entries[i].used)
+			continue;
+		if(stat(entries[i].path, &st) == 0 && cache_current(&entries[i].rec, &st))
+			entries[i].used = 1;
+		else
+			cache_dirty = 1;
+	}
+	if(!cache_dirty)
+		return;
+
+	if(cache_mkdir(cache_path) < 0) {
+		fprintf(stderr, "iconcache.c: Couldn't create the directory for %s.\n", cache_path);
+		return;
+	}
+
+	snprintf(temp, sizeof(temp), "%s.XXXXXX", cache_path);
+	fd = mkstemp(temp);
+	if(fd < 0 || (f = fdopen(fd, "w")) == NULL) {
+		if(fd >= 0) {
+			close(fd);
+			unlink(temp);
+		}
+		fprintf(stderr, "iconcache.c: Couldn't write %s.\n", cache_path);
+		return;
+	}
+
+	header = format;
+	header.count = 0;
+	for(i = 0; i < entry_count; i++) {
+		if(entries[i].used)
+			header.count++;
+	}
+	error |= cache_write(f, &header, sizeof(header));
+
+	for(i = 0; i < entry_count; i++) {
+		if(!entries[i].used)
+			continue;
+		error |= cache_write(f, &entries[i].rec, sizeof(CacheRecord));
+		error |= cache_write(f, entries[i].path, entries[i].rec.path_length);
+		error |= cache_write(f, entries[i].pixels,
+		                     (size_t) entries[i].rec.bytes_per_line * entries[i].rec.height);
+		error |= cache_write(f, entries[i].mask,
+		                     (size_t) entries[i].rec.mask_bytes_per_line * entries[i].rec.height);
+	}
+
+	if(fclose(f) != 0)
+		error = -1;
+
+	if(error || rename(temp, cache_path) < 0) {
+		unlink(temp);
+		fprintf(stderr, "iconcache.c: Couldn't write %s.\n", cache_path);
+		return;
+	}
+
+	cache_dirty = 0;
+}
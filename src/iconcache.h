@@ -0,0 +1,94 @@
+/* iconcache.h
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __ICONCACHE_H__
+#define __ICONCACHE_H__
+
+#include "../config.h"
+#include <sys/stat.h>
+#include <X11/Xlib.h>
+
+/* iconcache_load
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *      Pixmap *pixmap      : returns the icon
+ *      Pixmap *pixmask     : returns the mask, None if opaque
+ *      int *width, *height : returns the size of the icon
+ *
+ *  NOTE:
+ *      The cache file ($XDG_CACHE_HOME/wmappl/icons) holds decoded and
+ *      already scaled icons keyed by path, size, modification and change
+ *      time, to the nanosecond.
+ *      It is memory-mapped on first use and a hit is uploaded with
+ *      XPutImage, without running the decoder. Only TrueColor visuals
+ *      are cached, other visuals always miss, and only icons the
+ *      built-in XPM reader decoded are stored.
+ *
+ *  RETURN:
+ *      int : 0 on a hit, <0 if the icon has to be decoded
+ */
+int
+iconcache_load(Display *display, char *filename, struct stat *st,
+               Pixmap *pixmap, Pixmap *pixmask, int *width, int *height);
+
+/* iconcache_contains
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *
+ *  RETURN:
+ *      int : nonzero if iconcache_load would hit
+ */
+int
+iconcache_contains(Display *display, char *filename, struct stat *st);
+
+/* iconcache_store
+ *  PARAMETERS:
+ *      Display *display    : X11 display
+ *      char *filename      : resolved path of the icon
+ *      struct stat *st     : stat of filename
+ *      XImage *image       : ZPixmap the icon was uploaded from
+ *      XImage *mask        : XYPixmap of its mask, NULL if opaque
+ *
+ *  NOTE:
+ *      Copies the client-side images of a freshly decoded icon, to be
+ *      added to the cache by iconcache_save. Nothing is read back from
+ *      the server. The images stay the caller's.
+ */
+void
+iconcache_store(Display *display, char *filename, struct stat *st,
+                XImage *image, XImage *mask);
+
+/* iconcache_save
+ *  NOTE:
+ *      Rewrites the cache file if anything was decoded or the file of an
+ *      unused entry changed or went away, so stale icons drop out. Unused
+ *      entries of unchanged files are kept, they may simply not have
+ *      been loaded this time. Should be called once all the
+ *      icons have been loaded.
+ */
+void
+iconcache_save(void);
+
+#endif /* not __ICONCACHE_H__ */
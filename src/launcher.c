@@ -0,0 +1,565 @@
+/* launcher.c
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#define _GNU_SOURCE	/* close_range() */
+#include "launcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <stdint.h>
+
+/* highest descriptor closed by hand when close_range() is unavailable,
+ * our own descriptors are close-on-exec so this only catches ones
+ * inherited from the parent of wmappl */
+#define MAX_CLOSE_FD	1024
+
+/* characters that make a command need a real shell, unless quoted,
+ * '#' starts a comment there */
+#define SHELL_CHARS	"|;<>()$`*?[]{}~!#\n"
+
+/* search path used when PATH is not set */
+#define DEFAULT_PATH	"/bin:/usr/bin"
+
+/* largest request accepted by the launcher helper */
+#define MAX_REQUEST	65536
+
+/* self-pipe written to by the SIGCHLD handler */
+static int sigchld_pipe[2] = { -1, -1 };
+
+/* socket to the pre-forked launcher helper, -1 when not running */
+static int helper_fd = -1;
+
+/* sigchld_handler
+ *  NOTE:
+ *      Only wakes up the event loop, the children are collected
+ *      by launcher_reap().
+ */
+static void sigchld_handler(int sig)
+{
+	int saved_errno = errno;
+
+	if(write(sigchld_pipe[1], "", 1) < 0) {
+		/* pipe full, a wakeup is already pending */
+	}
+	errno = saved_errno;
+}
+
+/* set_fd_flags
+ *  NOTE:
+ *      Marks a descriptor close-on-exec and non-blocking.
+ */
+static void set_fd_flags(int fd)
+{
+	fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* child_setup
+ *  NOTE:
+ *      Runs in the forked child before exec.
+ */
+static void child_setup(void)
+{
+	sigset_t mask;
+	int fd;
+
+	/* restore the signal state the command expects */
+	signal(SIGCHLD, SIG_DFL);
+	sigemptyset(&mask);
+	sigprocmask(SIG_SETMASK, &mask, NULL);
+
+	/* do not leak the X connection or anything else */
+	fd = 3;
+#ifdef HAVE_CLOSE_RANGE
+	if(close_range(3, ~0U, 0) == 0)
+		fd = MAX_CLOSE_FD;
+#endif
+	for(; fd < MAX_CLOSE_FD; fd++)
+		close(fd);
+}
+
+/* resolve_program
+ *  PARAMETERS:
+ *      char *program : program name as given in the command
+ *  RETURN:
+ *      char * : allocated path of the executable, NULL if not found
+ */
+static char *resolve_program(char *program)
+{
+	struct stat st;
+	char *path, *dir, *end, *candidate;
+	size_t dirlen;
+
+	if(strchr(program, '/')) {
+		if(stat(program, &st) == 0 && S_ISREG(st.st_mode) && access(program, X_OK) == 0)
+			return strdup(program);
+		return NULL;
+	}
+
+	path = getenv("PATH");
+	if(path == NULL)
+		path = DEFAULT_PATH;
+
+	candidate = (char *) malloc(strlen(path) + strlen(program) + 3);
+	if(!candidate)
+		return NULL;
+
+	for(dir = path; ; dir = end + 1) {
+		end = strchr(dir, ':');
+		dirlen = end ? (size_t) (end - dir) : strlen(dir);
+
+		/* an empty entry is the current directory */
+		if(dirlen == 0) {
+			strcpy(candidate, ".");
+			dirlen = 1;
+		}
+		else {
+			memcpy(candidate, dir, dirlen);
+		}
+		candidate[dirlen] = '/';
+		strcpy(candidate + dirlen + 1, program);
+
+		if(stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0)
+			return (char *) realloc(candidate, strlen(candidate) + 1);
+
+		if(!end)
+			break;
+	}
+
+	free(candidate);
+	return NULL;
+}
+
+/* launcher_parse_command
+ *  PARAMETERS:
+ *      char *command : command line from the rc file
+ *  RETURN:
+ *      char ** : argument vector, NULL if /bin/sh is needed
+ */
+char **launcher_parse_command(char *command)
+{
+	char **argv = NULL, **tmpargv, *buf, *src, *dst, *program;
+	int argc, i, len;
+	size_t size;
+
+	if(command == NULL)
+		return NULL;
+
+	len = strlen(command);
+
+	/* every argument takes at least two characters of the command */
+	tmpargv = (char **) malloc(sizeof(char *) * (len / 2 + 2));
+	buf = (char *) malloc(len + 1);
+	if(!tmpargv || !buf)
+		goto done;
+
+	argc = 0;
+	src = command;
+	dst = buf;
+
+	while(1) {
+		while(*src == ' ' || *src == '\t')
+			src++;
+		if(*src == '\0')
+			break;
+
+		/* a trailing & only asks for the background, every launch is */
+		if(*src == '&') {
+			for(src++; *src == ' ' || *src == '\t'; src++);
+			if(*src != '\0')
+				goto done;
+			break;
+		}
+
+		tmpargv[argc++] = dst;
+
+		while(*src != '\0' && *src != ' ' && *src != '\t' && *src != '&') {
+			if(*src == '\'') {
+				for(src++; *src != '\0' && *src != '\''; )
+					*dst++ = *src++;
+				if(*src++ == '\0')
+					goto done;
+			}
+			else if(*src == '\"') {
+				for(src++; *src != '\0' && *src != '\"'; ) {
+					if(strchr("$`\\", *src))
+						goto done;
+					*dst++ = *src++;
+				}
+				if(*src++ == '\0')
+					goto done;
+			}
+			else if(*src == '\\') {
+				if(*++src == '\0')
+					goto done;
+				*dst++ = *src++;
+			}
+			/* variable assignments in front of the program */
+			else if(strchr(SHELL_CHARS, *src) || (*src == '=' && argc == 1)) {
+				goto done;
+			}
+			else {
+				*dst++ = *src++;
+			}
+		}
+		*dst++ = '\0';
+	}
+
+	if(argc == 0)
+		goto done;
+
+	program = resolve_program(tmpargv[0]);
+	if(!program)
+		goto done;
+
+	/* pack the vector and its strings into a single allocation */
+	size = sizeof(char *) * (argc + 1) + strlen(program) + 1 + (dst - buf);
+	argv = (char **) malloc(size);
+	if(argv) {
+		dst = (char *) &argv[argc + 1];
+		strcpy(dst, program);
+		argv[0] = dst;
+		dst += strlen(program) + 1;
+		for(i = 1; i < argc; i++) {
+			strcpy(dst, tmpargv[i]);
+			argv[i] = dst;
+			dst += strlen(dst) + 1;
+		}
+		argv[argc] = NULL;
+	}
+	free(program);
+
+done:
+	free(tmpargv);
+	free(buf);
+	return argv;
+}
+
+/* launcher_ignore_children
+ *  NOTE:
+ *      Fallback when children can't be reaped from the event loop,
+ *      the kernel then collects them itself.
+ */
+static void launcher_ignore_children(void)
+{
+	if(sigchld_pipe[0] >= 0) {
+		close(sigchld_pipe[0]);
+		close(sigchld_pipe[1]);
+		sigchld_pipe[0] = sigchld_pipe[1] = -1;
+	}
+
+	signal(SIGCHLD, SIG_IGN);
+	fprintf(stderr, "launcher.c: Ignoring SIGCHLD, exited commands are collected by the kernel.\n");
+}
+
+/* launcher_init
+ *  RETURN:
+ *      int : file descriptor to watch, <0 on error
+ */
+int launcher_init(void)
+{
+	struct sigaction sa;
+
+	if(sigchld_pipe[0] >= 0)
+		return sigchld_pipe[0];
+
+	if(pipe(sigchld_pipe) < 0) {
+		perror("launcher.c (error) : pipe()");
+		launcher_ignore_children();
+		return -1;
+	}
+	set_fd_flags(sigchld_pipe[0]);
+	set_fd_flags(sigchld_pipe[1]);
+
+	sa.sa_handler = sigchld_handler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	if(sigaction(SIGCHLD, &sa, NULL) < 0) {
+		perror("launcher.c (error) : sigaction()");
+		launcher_ignore_children();
+		return -1;
+	}
+
+	return sigchld_pipe[0];
+}
+
+/* launcher_reap
+ *  PARAMETERS:
+ *      int fd : the descriptor returned by launcher_init
+ */
+void launcher_reap(int fd)
+{
+	char buf[64];
+
+	/* drain the wakeups, one SIGCHLD may stand for several children */
+	while(read(fd, buf, sizeof(buf)) > 0);
+
+	while(waitpid(-1, NULL, WNOHANG) > 0);
+}
+
+/* spawn
+ *  PARAMETERS:
+ *      int shell   : non-zero to run argv[0] through /bin/sh -c
+ *      char **argv : command line or argument vector
+ *  RETURN:
+ *      pid_t : process id of the child, <0 on error
+ */
+static pid_t spawn(int shell, char **argv)
+{
+	pid_t pid;
+
+	pid = fork();
+	if(pid < 0) {
+		perror("launcher.c (error) : fork()");
+		return -1;
+	}
+
+	if(pid == 0) {
+		child_setup();
+		if(shell)
+			execl("/bin/sh", "sh", "-c", argv[0], (char *) NULL);
+		else
+			execv(argv[0], argv);
+		_exit(127);
+	}
+
+	return pid;
+}
+
+/* write_all
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+static int write_all(int fd, char *buf, size_t len)
+{
+	ssize_t n;
+
+	while(len > 0) {
+		n = send(fd, buf, len, MSG_NOSIGNAL);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* read_all
+ *  RETURN:
+ *      int : 1 on success, 0 on end of file, <0 on error
+ */
+static int read_all(int fd, char *buf, size_t len)
+{
+	ssize_t n;
+
+	while(len > 0) {
+		n = read(fd, buf, len);
+		if(n == 0)
+			return 0;
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 1;
+}
+
+/* helper_main
+ *  PARAMETERS:
+ *      int fd : the helper's end of the socket pair
+ *
+ *  NOTE:
+ *      Main loop of the pre-forked helper. Each request is a length
+ *      followed by a type byte ('c' for a shell command, 'v' for an
+ *      argument vector) and the NUL terminated strings. The helper
+ *      exits when the dockapp closes its end of the socket.
+ */
+static void helper_main(int fd)
+{
+	uint32_t len, n;
+	char *buf, **argv;
+	int i, argc;
+
+	/* the helper never waits for its children */
+	signal(SIGCHLD, SIG_IGN);
+
+	while(read_all(fd, (char *) &len, sizeof(len)) > 0) {
+		if(len < 2 || len > MAX_REQUEST)
+			break;
+
+		buf = (char *) malloc(len);
+		if(!buf || read_all(fd, buf, len) <= 0)
+			break;
+		buf[len - 1] = '\0';
+
+		for(n = 1, argc = 0; n < len; n++) {
+			if(buf[n] == '\0')
+				argc++;
+		}
+
+		argv = (char **) malloc(sizeof(char *) * (argc + 1));
+		if(argv) {
+			argv[0] = &buf[1];
+			for(i = 1; i < argc; i++)
+				argv[i] = argv[i - 1] + strlen(argv[i - 1]) + 1;
+			argv[argc] = NULL;
+
+			spawn(buf[0] == 'c', argv);
+			free(argv);
+		}
+		free(buf);
+	}
+
+	_exit(0);
+}
+
+/* helper_request
+ *  PARAMETERS:
+ *      char type   : 'c' for a shell command, 'v' for an argument vector
+ *      char **argv : NULL terminated strings to send
+ *  RETURN:
+ *      int : 0 if the helper took the request, <0 on error
+ */
+static int helper_request(char type, char **argv)
+{
+	uint32_t len;
+	char *buf, *p;
+	int i, r;
+
+	for(i = 0, len = 1; argv[i]; i++)
+		len += strlen(argv[i]) + 1;
+	if(len > MAX_REQUEST)
+		return -1;
+
+	buf = (char *) malloc(sizeof(len) + len);
+	if(!buf)
+		return -1;
+
+	memcpy(buf, &len, sizeof(len));
+	p = buf + sizeof(len);
+	*p++ = type;
+	for(i = 0; argv[i]; i++) {
+		strcpy(p, argv[i]);
+		p += strlen(argv[i]) + 1;
+	}
+
+	r = write_all(helper_fd, buf, sizeof(len) + len);
+	free(buf);
+
+	/* the helper is gone, launch from this process from now on */
+	if(r < 0) {
+		fprintf(stderr, "launcher.c (warning) : launcher helper died, forking directly.\n");
+		close(helper_fd);
+		helper_fd = -1;
+	}
+	return r;
+}
+
+/* launcher_start_helper
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int launcher_start_helper(void)
+{
+	int sv[2];
+	pid_t pid;
+
+	if(helper_fd >= 0)
+		return 0;
+
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		perror("launcher.c (error) : socketpair()");
+		return -1;
+	}
+
+	pid = fork();
+	if(pid < 0) {
+		perror("launcher.c (error) : fork()");
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+	}
+
+	if(pid == 0) {
+		close(sv[0]);
+		helper_main(sv[1]);
+	}
+
+	close(sv[1]);
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	helper_fd = sv[0];
+	return 0;
+}
+
+/* launch_command
+ *  PARAMETERS:
+ *      char *command : command line to run through /bin/sh
+ *  RETURN:
+ *      pid_t : process id of the child, 0 if it was handed to the
+ *              launcher helper, <0 on error
+ */
+pid_t launch_command(char *command)
+{
+	char *argv[2];
+
+	if(command == NULL)
+		return -1;
+
+	argv[0] = command;
+	argv[1] = NULL;
+
+	if(helper_fd >= 0 && helper_request('c', argv) == 0)
+		return 0;
+
+	return spawn(1, argv);
+}
+
+/* launch_argv
+ *  PARAMETERS:
+ *      char **argv : vector from launcher_parse_command
+ *  RETURN:
+ *      pid_t : process id of the child, 0 if it was handed to the
+ *              launcher helper, <0 on error
+ */
+pid_t launch_argv(char **argv)
+{
+	if(argv == NULL || argv[0] == NULL)
+		return -1;
+
+	if(helper_fd >= 0 && helper_request('v', argv) == 0)
+		return 0;
+
+	return spawn(0, argv);
+}
@@ -0,0 +1,117 @@
+/* launcher.h
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __LAUNCHER_H__
+#define __LAUNCHER_H__
+
+#include "../config.h"
+#include <sys/types.h>
+
+/* launcher_init
+ *  NOTE:
+ *      Installs the SIGCHLD handler and returns the read end of the
+ *      self-pipe it writes to. The caller should watch this descriptor
+ *      and call launcher_reap() when it becomes readable. If the pipe
+ *      or the handler can't be set up, SIGCHLD is ignored instead so
+ *      that launched commands still don't become zombies.
+ *
+ *  RETURN:
+ *      int : file descriptor to watch, <0 on error
+ */
+int
+launcher_init(void);
+
+/* launcher_start_helper
+ *  NOTE:
+ *      Forks a small helper process that launches commands on behalf
+ *      of the dockapp, so that the (large) X client process never has
+ *      to fork. It should be called early, before the display is
+ *      opened and the icons are loaded, while this process is still
+ *      small. Requests are passed over a socket pair, if the helper
+ *      goes away commands are forked directly again.
+ *
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int
+launcher_start_helper(void);
+
+/* launcher_reap
+ *  PARAMETERS:
+ *      int fd : the descriptor returned by launcher_init
+ *
+ *  NOTE:
+ *      Drains the self-pipe and collects every exited child, so that
+ *      launched commands never become zombies.
+ */
+void
+launcher_reap(int fd);
+
+/* launch_command
+ *  PARAMETERS:
+ *      char *command : command line to run through /bin/sh
+ *
+ *  NOTE:
+ *      Returns as soon as the child has been forked, the command runs
+ *      asynchronously. The child does not inherit any descriptors
+ *      besides stdin, stdout and stderr.
+ *
+ *  RETURN:
+ *      pid_t : process id of the child, 0 if it was handed to the
+ *              launcher helper, <0 on error
+ */
+pid_t
+launch_command(char *command);
+
+/* launcher_parse_command
+ *  PARAMETERS:
+ *      char *command : command line from the rc file
+ *
+ *  NOTE:
+ *      Splits a plain "program arg arg &" command into an argument
+ *      vector, honouring quotes and backslashes, and resolves the
+ *      program against PATH. Commands using real shell syntax (pipes,
+ *      redirections, variables, globs, ...) or naming a program that
+ *      cannot be found are left to /bin/sh. The vector and its strings
+ *      are a single allocation, release it with free().
+ *
+ *  RETURN:
+ *      char ** : NULL terminated argument vector with argv[0] holding
+ *                the path of the program, NULL if /bin/sh is needed
+ */
+char**
+launcher_parse_command(char *command);
+
+/* launch_argv
+ *  PARAMETERS:
+ *      char **argv : vector from launcher_parse_command
+ *
+ *  NOTE:
+ *      Like launch_command, but executes the program directly.
+ *
+ *  RETURN:
+ *      pid_t : process id of the child, 0 if it was handed to the
+ *              launcher helper, <0 on error
+ */
+pid_t
+launch_argv(char **argv);
+
+#endif /* not __LAUNCHER_H__ */
@@ -21,6 +21,107 @@
 
 #include "options.h"
 
+/* initial number of buckets in the icon index */
+#define ICON_INDEX_SIZE 256
+
+/* icon_hash - string hash for the icon index */
+static unsigned int icon_hash(const char *s) {
+	unsigned int h = 5381;
+
+	while(*s)
+		h = h * 33 + (unsigned char) *s++;
+
+	return h;
+}
+
+/* icon_index_lookup - finds name in the icon index, NULL if not there */
+static IconEntry *icon_index_lookup(IconPath *ip, const char *name) {
+	IconEntry *e;
+
+	if(ip->index == NULL)
+		return NULL;
+
+	for(e = ip->index[icon_hash(name) & (ip->index_size - 1)]; e != NULL; e = e->next) {
+		if(strcmp(e->name, name) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+/* icon_index_grow - doubles the number of buckets in the icon index */
+static void icon_index_grow(IconPath *ip) {
+	IconEntry **index, *e, *next;
+	int i, size;
+
+	size = ip->index_size ? ip->index_size * 2 : ICON_INDEX_SIZE;
+	index = (IconEntry **) calloc(size, sizeof(IconEntry *));
+	if(!index) {
+		fprintf(stderr, "options.c: Couldn't allocate icon index.\n");
+		exit(1);
+	}
+
+	for(i = 0; i < ip->index_size; i++) {
+		for(e = ip->index[i]; e != NULL; e = next) {
+			next = e->next;
+			e->next = index[icon_hash(e->name) & (size - 1)];
+			index[icon_hash(e->name) & (size - 1)] = e;
+		}
+	}
+
+	free(ip->index);
+	ip->index = index;
+	ip->index_size = size;
+}
+
+/* icon_index_directory - adds the files in directory to the icon index,
+ * names already found in an earlier directory are kept */
+static void icon_index_directory(IconPath *ip, const char *directory) {
+	DIR *dir;
+	struct dirent *d;
+	IconEntry *e;
+	size_t dirlen, namelen;
+	unsigned int bucket;
+
+	dir = opendir(*directory ? directory : ".");
+	if(dir == NULL)
+		return;
+
+	dirlen = strlen(directory);
+
+	while((d = readdir(dir)) != NULL) {
+		if(d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+		   (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+			continue;
+
+		/* the first directory containing a name wins */
+		if(icon_index_lookup(ip, d->d_name) != NULL)
+			continue;
+
+		if(ip->index_count >= ip->index_size)
+			icon_index_grow(ip);
+
+		/* entry and path share one allocation */
+		namelen = strlen(d->d_name);
+		e = (IconEntry *) malloc(sizeof(IconEntry) + dirlen + namelen + 1);
+		if(!e) {
+			fprintf(stderr, "options.c: Couldn't allocate icon index entry.\n");
+			exit(1);
+		}
+		e->path = (char *) (e + 1);
+		memcpy(e->path, directory, dirlen);
+		memcpy(e->path + dirlen, d->d_name, namelen + 1);
+		e->name = e->path + dirlen;
+
+		bucket = icon_hash(e->name) & (ip->index_size - 1);
+		e->next = ip->index[bucket];
+		ip->index[bucket] = e;
+		ip->index_count++;
+	}
+
+	closedir(dir);
+}
+
 /* opt_create_iconpath
  *  PARAMETERS:
  *      char * : colon separated path
@@ -110,19 +211,90 @@ IconPath *opt_create_iconpath(char *colonpath) {
 	/* store the directory in the IconPath structure */
 	return_path->path[k] = directory;
 
+	/* index the current directory, then the path in order */
+	return_path->index_size = 0;
+	return_path->index_count = 0;
+	return_path->index = NULL;
+	icon_index_directory(return_path, "");
+	for(i = 0; i < return_path->count; i++)
+		icon_index_directory(return_path, return_path->path[i]);
+
 	return return_path;
 }
 
+/* opt_find_icon
+ *  PARAMETERS:
+ *      IconPath * : icon path to search
+ *      char *     : icon file name
+ *  RETURN:
+ *      char * : newly allocated path to the icon, NULL if not found
+ */
+char *opt_find_icon(IconPath *ip, char *filename) {
+	IconEntry *e;
+	char *abspath;
+	int i;
+
+	if(!filename || !ip)
+		return (char *) NULL;
+
+	/* plain file names are answered by the index */
+	if(strchr(filename, DIRSEP) == NULL) {
+		e = icon_index_lookup(ip, filename);
+		if(e == NULL)
+			return (char *) NULL;
+
+		abspath = (char *) malloc(sizeof(char) * (strlen(e->path) + 1));
+		if(!abspath) {
+			fprintf(stderr, "options.c: Couldn't allocate string.\n");
+			exit(1);
+		}
+		strcpy(abspath, e->path);
+
+		return abspath;
+	}
+
+	/* absolute path, or relative to the current directory */
+	abspath = (char *) malloc(ip->dirallocsize + (sizeof(char) * strlen(filename)));
+	if(!abspath) {
+		fprintf(stderr, "options.c: Couldn't allocate string.\n");
+		exit(1);
+	}
+	strcpy(abspath, filename);
+	if(access(abspath, R_OK) == 0)
+		return abspath;
+
+	/* a subdirectory of one of the icon path directories */
+	if(filename[0] != DIRSEP) {
+		for(i = 0; i < ip->count; i++) {
+			strcpy(abspath, ip->path[i]);
+			strcat(abspath, filename);
+			if(access(abspath, R_OK) == 0)
+				return abspath;
+		}
+	}
+
+	free(abspath);
+	return (char *) NULL;
+}
+
 /* opt_free_iconpath
  *  PARAMETERS:
  *      IconPath * : IconPath structure to free
  */
 void opt_free_iconpath(IconPath *ip) {
+	IconEntry *e, *next;
 	int i;
 	if(ip==NULL) return;
 	for(i=0; i<ip->count; i++) {
 		free(ip->path[i]);
 	}
+	for(i=0; i<ip->index_size; i++) {
+		for(e=ip->index[i]; e!=NULL; e=next) {
+			next=e->next;
+			free(e);
+		}
+	}
+	free(ip->index);
 	free(ip->path);
 	free(ip);
 }
@@ -137,10 +309,14 @@ wmappl_opt *opt_create_options() {
 	/* set default values */
 	o->withdrawn=-1;
 	o->debugmode=-1;
+	o->prefork=-1;
+	o->lazy=-1;
+	o->pixmap_cache_kb=-1;
 	o->name=NULL;
 	o->colonpath=NULL;
 	o->bgcolor=NULL;
 	o->bgicon=NULL;
+	o->rcexec=NULL;
 #ifdef USE_TOOLTIPS
 	o->tooltipDelay=-1;
 	o->tooltipfg=NULL;
@@ -161,6 +337,7 @@ void opt_free_options(wmappl_opt *opts) {
 	if(opts->colonpath!=NULL) free(opts->colonpath);
 	if(opts->bgcolor!=NULL) free(opts->bgcolor);
 	if(opts->bgicon!=NULL) free(opts->bgicon);
+	if(opts->rcexec!=NULL) free(opts->rcexec);
 #ifdef USE_TOOLTIPS
 	if(opts->tooltipfg) free(opts->tooltipfg);
 	if(opts->tooltipbg) free(opts->tooltipbg);
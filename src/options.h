@@ -27,17 +27,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
 
 /* MACRO defining the path separator */
 #define PATHSEP     ':'
 /* MACRO defining the directory separator (separating each individual directory) */
 #define DIRSEP      '/'
 
+/* icon path index entry, one per file found in the icon path */
+typedef struct _IconEntry_ {
+    char *name;                 /* file name, points into path */
+    char *path;                 /* directory and file name */
+    struct _IconEntry_ *next;   /* next entry in the same bucket */
+} IconEntry;
+
 /* icon path structure */
 typedef struct _IconPath_ {
     int count;
     size_t dirallocsize;
     char **path;
+    int index_size;             /* number of buckets, a power of two */
+    int index_count;            /* number of entries */
+    IconEntry **index;          /* file name -> first path it was found at */
 } IconPath;
 
 
@@ -45,10 +56,14 @@ typedef struct _IconPath_ {
 typedef struct _wmappl_opt_ {
 	int withdrawn;
 	int debugmode;
+	int prefork;
+	int lazy;
+	int pixmap_cache_kb;
 	char *name;
 	char *colonpath;
 	char *bgcolor;
 	char *bgicon;
+	char *rcexec;		/* command printing the rc file */
 #ifdef USE_TOOLTIPS
 	int   tooltipDelay;
 	char *tooltipfg;
@@ -61,11 +76,28 @@ typedef struct _wmappl_opt_ {
 /* opt_create_iconpath
  *  PARAMETERS:
  *      char * : colon separated path
+ *  NOTE:
+ *      The current directory and then each directory of the path are
+ *      read once here to build the index used by opt_find_icon.
  * RETURN:
  *      IconPath *  : the icon path as a structure 
 */
 IconPath *opt_create_iconpath(char *colonpath);
 
+/* opt_find_icon
+ *  PARAMETERS:
+ *      IconPath * : icon path to search
+ *      char *     : icon file name
+ *  NOTE:
+ *      Plain file names are looked up in the index, in the same order
+ *      the directories used to be probed: the current directory first,
+ *      then the icon path. Names containing a directory are checked
+ *      on disk.
+ *  RETURN:
+ *      char * : newly allocated path to the icon, NULL if not found
+ */
+char *opt_find_icon(IconPath *ip, char *filename);
+
 /* opt_free_iconpath
  *  PARAMETERS:
  *      IconPath * : IconPath structure to free
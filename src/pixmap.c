@@ -20,7 +20,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "pixmap.h"
+#include "iconcache.h"
+#include "scale.h"
 
 #include <X11/xpm.h>
 #include <X11/Xlib.h>
@@ -29,21 +35,52 @@
 #  include <Imlib2.h>
 #endif
 
+#if HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+/* upper limit for the number of decoding threads */
+#define MAX_DECODE_THREADS 16
+
+/* file_stamp - what st says about a file */
+static void file_stamp ( struct stat *st, FileStamp *stamp )
+{
+  stamp->dev   = st->st_dev;
+  stamp->ino   = st->st_ino;
+  stamp->mtime = st->st_mtim;
+  stamp->ctime = st->st_ctim;
+}
+
+/* same_file - nonzero if stamp still describes the file of st */
+static int same_file ( FileStamp *stamp, struct stat *st )
+{
+  return stamp->ino == st->st_ino && stamp->dev == st->st_dev &&
+         stamp->mtime.tv_sec == st->st_mtim.tv_sec && stamp->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+         stamp->ctime.tv_sec == st->st_ctim.tv_sec && stamp->ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
 
 
 int create_button_pixmap ( Display        *display,
 			   char           *filename,
+			   int             size,
 			   Pixmap         *pixmap,
 			   Pixmap         *pixmask,
-			   XpmAttributes  *xpmattributes )
+			   XpmAttributes  *xpmattributes,
+			   XImage        **ximage,
+			   XImage        **xmask )
 {
 #if HAVE_IMLIB2
   static int    FirstTime = 1;
 
+  // rendered by Imlib2 on the server, there is no image to hand back
+  if (ximage)
+    *ximage = *xmask = NULL;
+
   if (FirstTime) {
-    //    imlib_set_cache_size(128 * 1024);
-    //    imlib_set_font_cache_size(32 * 1024);
-    //    imlib_set_color_usage(128);
+    // images are decoded once and kept as server pixmaps, there is
+    // nothing for Imlib2's own caches to hold on to
+    imlib_set_cache_size(0);
+    imlib_set_font_cache_size(0);
 
     imlib_context_set_display(display);
     imlib_context_set_visual(DefaultVisual(display,DefaultScreen(display)));
@@ -57,59 +94,400 @@ int create_button_pixmap ( Display        *display,
   }
 
   do {
-    int width, height;
-    Imlib_Image   image;
+    Imlib_Image   image, scaled;
+    Pixmap        rendered, renderedmask;
+    int           width, height;
+    Window        root   = RootWindow(display, DefaultScreen(display));
+    GC            gc;
 
     image = imlib_load_image(filename);
+    if (image == NULL) {
+      fprintf(stderr, "pixmap.c (error) : Failed to load image file %s.\n", filename);
+      return -1;
+    }
     imlib_context_set_image(image);
+    width  = size ? size : imlib_image_get_width();
+    height = size ? size : imlib_image_get_height();
 
-    width  = imlib_image_get_width();
-    height = imlib_image_get_height();
-
-    // pixmap and pixmask are required for imlib_render
-    *pixmap = XCreatePixmap(display,
-			    RootWindow(display,DefaultScreen(display)),
-			    width,
-			    height,
-			    DefaultDepth(display,DefaultScreen(display)));
+    // scale once, so that neither the renderer nor the server ever
+    // see the full size image
+    if (imlib_image_get_width() != width || imlib_image_get_height() != height) {
+      scaled = imlib_create_cropped_scaled_image(0, 0,
+						 imlib_image_get_width(),
+						 imlib_image_get_height(),
+						 width, height);
+      imlib_free_image_and_decache();
+      if (scaled == NULL) {
+	fprintf(stderr, "pixmap.c (error) : Failed to scale image file %s.\n", filename);
+	return -1;
+      }
+      imlib_context_set_image(scaled);
+    }
 
-    *pixmask = XCreatePixmap(display,
-			     RootWindow(display,DefaultScreen(display)),
-			     width,
-			     height,
-			     DefaultDepth(display,DefaultScreen(display)));
+    // Imlib2 creates the pixmaps itself, the mask at depth 1 (or none
+    // if the image is opaque). They belong to its pixmap cache, so the
+    // result is copied into pixmaps of our own and handed back.
+    imlib_render_pixmaps_for_whole_image(&rendered, &renderedmask);
+    imlib_free_image_and_decache();
+    if (rendered == None) {
+      fprintf(stderr, "pixmap.c (error) : Failed to render image file %s.\n", filename);
+      return -1;
+    }
 
-    imlib_context_set_drawable(*pixmap);
-    imlib_context_set_mask(*pixmask);
+    *pixmap = XCreatePixmap(display, root, width, height,
+			    DefaultDepth(display, DefaultScreen(display)));
+    gc = XCreateGC(display, *pixmap, 0, NULL);
+    XCopyArea(display, rendered, *pixmap, gc, 0, 0, width, height, 0, 0);
+    XFreeGC(display, gc);
 
-    if ( width == 16 && height == 16 ) {
-      imlib_render_pixmaps_for_whole_image(pixmap,pixmask);
-    }
-    else {
-      imlib_render_pixmaps_for_whole_image_at_size(pixmap,pixmask,16,16);
+    *pixmask = None;
+    if (renderedmask != None) {
+      *pixmask = XCreatePixmap(display, root, width, height, 1);
+      gc = XCreateGC(display, *pixmask, 0, NULL);
+      XCopyArea(display, renderedmask, *pixmask, gc, 0, 0, width, height, 0, 0);
+      XFreeGC(display, gc);
     }
 
-    imlib_free_image();
+    imlib_free_pixmap_and_mask(rendered);
 
     // Fill in some fields in xpmattributes, required by wmappl.
-    // Dimensions are always correct, either because the icon had 
-    // the correct size, or because it was resized by Imlib2
-    xpmattributes->width  = 16;
-    xpmattributes->height = 16;
+    xpmattributes->width  = width;
+    xpmattributes->height = height;
 
   } while (0);
 
 
 #else
+  DecodedXpm xpm;
+  int        status;
+
+  if (ximage)
+    *ximage = *xmask = NULL;
+
   /* load the xpm file */
-  if(XpmReadFileToPixmap(display,
-			 RootWindow(display, DefaultScreen(display)),
-			 filename, pixmap, pixmask, xpmattributes) != XpmSuccess) {
-    fprintf(stderr, "pixmap.c (error) : Failed to load XPM file %s.\n", filename);
+  status = decode_button_image(filename, &xpm);
+  if (status == -2) {
+    /* not something the built in reader handles, leave it to libXpm */
+    if (XpmReadFileToPixmap(display,
+			    RootWindow(display, DefaultScreen(display)),
+			    filename, pixmap, pixmask, xpmattributes) != XpmSuccess) {
+      fprintf(stderr, "pixmap.c (error) : Failed to load XPM file %s.\n", filename);
+      return -1;
+    }
+    return 0;
+  }
+  if (status < 0)
+    return -1;
 
+  status = upload_button_image(display, &xpm, size, pixmap, pixmask, xpmattributes, ximage, xmask);
+  xpmread_free(&xpm);
+
+  if (status < 0) {
+    fprintf(stderr, "pixmap.c (error) : Failed to load XPM file %s.\n", filename);
     return -1;
   }
 #endif
 
   return 0;
 }
+
+#if !HAVE_IMLIB2
+int decode_button_image ( char *filename, DecodedXpm *xpm )
+{
+  int status;
+
+  status = xpmread_file(filename, xpm);
+  if (status == -1)
+    fprintf(stderr, "pixmap.c (error) : Failed to load XPM file %s.\n", filename);
+
+  return status;
+}
+
+int upload_button_image ( Display        *display,
+			  DecodedXpm     *xpm,
+			  int             size,
+			  Pixmap         *pixmap,
+			  Pixmap         *pixmask,
+			  XpmAttributes  *xpmattributes,
+			  XImage        **ximage,
+			  XImage        **xmask )
+{
+  int width  = size ? size : xpm->width;
+  int height = size ? size : xpm->height;
+
+  if (xpmread_create_scaled_pixmap(display, xpm, width, height, pixmap, pixmask, ximage, xmask) < 0)
+    return -1;
+
+  /* the scaler keeps images it can't filter as they are */
+  if (xpm->width > SCALE_MAX_SIDE || xpm->height > SCALE_MAX_SIDE) {
+    width  = xpm->width;
+    height = xpm->height;
+  }
+  xpmattributes->width  = width;
+  xpmattributes->height = height;
+
+  return 0;
+}
+
+/* icons decoded ahead of time by preload_icon_images */
+typedef struct _DecodedIcon_ {
+  char          *filename;
+  FileStamp      file;
+  int            status;        /* result of decode_button_image */
+  DecodedXpm     xpm;
+  struct _DecodedIcon_ *next;
+} DecodedIcon;
+
+static DecodedIcon *decoded = NULL;
+
+/* work queue shared by the decoding threads */
+static DecodedIcon **decode_jobs;
+static int decode_count, decode_next;
+#if HAVE_PTHREAD
+static pthread_mutex_t decode_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void *decode_worker ( void *arg )
+{
+  int i;
+
+  (void) arg;
+
+  for (;;) {
+#if HAVE_PTHREAD
+    pthread_mutex_lock(&decode_lock);
+#endif
+    i = decode_next++;
+#if HAVE_PTHREAD
+    pthread_mutex_unlock(&decode_lock);
+#endif
+    if (i >= decode_count)
+      break;
+
+    decode_jobs[i]->status = decode_button_image(decode_jobs[i]->filename, &decode_jobs[i]->xpm);
+  }
+
+  return NULL;
+}
+
+/* take_decoded_icon - removes and returns the preloaded icon for st */
+static DecodedIcon *take_decoded_icon ( struct stat *st )
+{
+  DecodedIcon **p, *d;
+
+  for (p = &decoded; *p != NULL; p = &(*p)->next) {
+    d = *p;
+    if (same_file(&d->file, st)) {
+      *p = d->next;
+      return d;
+    }
+  }
+
+  return NULL;
+}
+#endif /* !HAVE_IMLIB2 */
+
+/* number of buckets in the icon image cache, a power of two */
+#define IMAGE_CACHE_SIZE 64
+
+static IconImage *image_cache[IMAGE_CACHE_SIZE];
+static unsigned long image_cache_bytes = 0;
+
+#define image_bucket(ino)  ((unsigned long) (ino) & (IMAGE_CACHE_SIZE - 1))
+
+/* find_icon_image - returns the cached image for st, NULL if none */
+static IconImage *find_icon_image ( struct stat *st )
+{
+  IconImage *image;
+
+  for (image = image_cache[image_bucket(st->st_ino)]; image != NULL; image = image->next) {
+    if (same_file(&image->file, st))
+      return image;
+  }
+
+  return NULL;
+}
+
+#if !HAVE_IMLIB2
+void preload_icon_images ( Display *display, char **filenames, int count )
+{
+  DecodedIcon  *d;
+  struct stat   st;
+  int           i, threads;
+#if HAVE_PTHREAD
+  pthread_t     thread[MAX_DECODE_THREADS];
+  long          cpus;
+#endif
+
+  decode_jobs = (DecodedIcon **) malloc(sizeof(DecodedIcon *) * (count > 0 ? count : 1));
+  if (!decode_jobs)
+    return;
+  decode_count = 0;
+  decode_next = 0;
+
+  /* queue every file once, unless it is already available */
+  for (i = 0; i < count; i++) {
+    if (stat(filenames[i], &st) < 0 || find_icon_image(&st) != NULL ||
+        iconcache_contains(display, filenames[i], &st))
+      continue;
+
+    for (d = decoded; d != NULL; d = d->next) {
+      if (same_file(&d->file, &st))
+        break;
+    }
+    if (d != NULL)
+      continue;
+
+    d = (DecodedIcon *) malloc(sizeof(DecodedIcon) + strlen(filenames[i]) + 1);
+    if (!d)
+      break;
+    d->filename = (char *) (d + 1);
+    strcpy(d->filename, filenames[i]);
+    file_stamp(&st, &d->file);
+    d->status = -1;
+    d->next = decoded;
+    decoded = d;
+
+    decode_jobs[decode_count++] = d;
+  }
+
+#if HAVE_PTHREAD
+  /* the main thread decodes as well */
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  threads = (cpus > 1 ? cpus : 1) - 1;
+  if (threads > MAX_DECODE_THREADS)
+    threads = MAX_DECODE_THREADS;
+  if (threads > decode_count - 1)
+    threads = decode_count - 1;
+
+  for (i = 0; i < threads; i++) {
+    if (pthread_create(&thread[i], NULL, decode_worker, NULL) != 0)
+      break;
+  }
+  threads = i;
+
+  decode_worker(NULL);
+
+  for (i = 0; i < threads; i++)
+    pthread_join(thread[i], NULL);
+#else
+  decode_worker(NULL);
+#endif
+
+  free(decode_jobs);
+  decode_jobs = NULL;
+}
+#endif /* !HAVE_IMLIB2 */
+
+IconImage *acquire_icon_image ( Display *display, char *filename )
+{
+  IconImage     *image;
+  XpmAttributes  xpmattributes;
+  XImage        *ximage = NULL, *xmask = NULL;
+  struct stat    st;
+  int            status, depth;
+#if !HAVE_IMLIB2
+  DecodedIcon   *d;
+#endif
+
+  if (stat(filename, &st) < 0) {
+    fprintf(stderr, "pixmap.c (error) : Couldn't stat %s.\n", filename);
+    return NULL;
+  }
+
+  /* share the image if this file has been loaded already */
+  if ((image = find_icon_image(&st)) != NULL) {
+    image->refcount++;
+    return image;
+  }
+
+  image = (IconImage *) malloc(sizeof(IconImage));
+  if (!image) {
+    fprintf(stderr, "pixmap.c (error) : Couldn't allocate space for an icon image.\n");
+    return NULL;
+  }
+
+  /* only decode what the on-disk cache doesn't already have */
+  if (iconcache_load(display, filename, &st, &image->pixmap, &image->pixmask,
+                     &image->width, &image->height) < 0) {
+    xpmattributes.valuemask = 0;
+#if !HAVE_IMLIB2
+    /* upload it if it was preloaded */
+    d = take_decoded_icon(&st);
+    if (d != NULL && d->status != -2) {
+      status = d->status;
+      if (status == 0) {
+        status = upload_button_image(display, &d->xpm, ICON_SIZE, &image->pixmap, &image->pixmask,
+                                     &xpmattributes, &ximage, &xmask);
+        xpmread_free(&d->xpm);
+        if (status < 0)
+          fprintf(stderr, "pixmap.c (error) : Failed to load XPM file %s.\n", filename);
+      }
+    }
+    else
+#endif
+    status = create_button_pixmap(display, filename, ICON_SIZE, &image->pixmap, &image->pixmask,
+                                  &xpmattributes, &ximage, &xmask);
+#if !HAVE_IMLIB2
+    free(d);
+#endif
+
+    if (status < 0) {
+      free(image);
+      return NULL;
+    }
+
+    image->width    = xpmattributes.width;
+    image->height   = xpmattributes.height;
+
+    /* the pixels that were just uploaded go to the on-disk cache */
+    if (ximage) {
+      iconcache_store(display, filename, &st, ximage, xmask);
+      XDestroyImage(ximage);
+      if (xmask)
+        XDestroyImage(xmask);
+    }
+  }
+
+  /* a depth-1 mask plus the pixmap, padded like the server does */
+  depth = DefaultDepth(display, DefaultScreen(display));
+  image->bytes    = (unsigned long) image->width * image->height * (depth > 16 ? 4 : depth > 8 ? 2 : 1);
+  if (image->pixmask != None)
+    image->bytes += (unsigned long) (image->width + 7) / 8 * image->height;
+  image_cache_bytes += image->bytes;
+
+  image->refcount = 1;
+  file_stamp(&st, &image->file);
+
+  image->next = image_cache[image_bucket(st.st_ino)];
+  image_cache[image_bucket(st.st_ino)] = image;
+
+  return image;
+}
+
+void release_icon_image ( Display *display, IconImage *image )
+{
+  IconImage **p;
+
+  if (image == NULL || --image->refcount > 0)
+    return;
+
+  /* unlink it from the cache */
+  for (p = &image_cache[image_bucket(image->file.ino)]; *p != NULL; p = &(*p)->next) {
+    if (*p == image) {
+      *p = image->next;
+      break;
+    }
+  }
+
+  XFreePixmap(display, image->pixmap);
+  if (image->pixmask != None)
+    XFreePixmap(display, image->pixmask);
+  image_cache_bytes -= image->bytes;
+  free(image);
+}
+
+unsigned long icon_image_memory ( void )
+{
+  return image_cache_bytes;
+}
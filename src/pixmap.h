@@ -24,21 +24,142 @@
 
 #include "../config.h"
 
+#include <sys/types.h>
+#include <time.h>
 #include <X11/xpm.h>
 #include <X11/Xlib.h>
+#include "xpmread.h"
+
+/* side of the square images on the buttons, icons of other sizes are
+ * scaled to it */
+#define ICON_SIZE 16
+
+/* identity of a file, the times keep their nanoseconds so a rewrite
+ * within the same second still shows */
+typedef struct {
+  dev_t           dev;
+  ino_t           ino;
+  struct timespec mtime, ctime;
+} FileStamp;
+
+/* decoded icon, shared by every button showing the same file */
+typedef struct _IconImage_ {
+  Pixmap        pixmap;
+  Pixmap        pixmask;
+  int           width, height;
+  int           refcount;
+  FileStamp     file;           /* the file it was read from */
+  unsigned long bytes;          /* estimated server memory of the pixmaps */
+  struct _IconImage_ *next;     /* next image in the same cache bucket */
+} IconImage;
 
 /* create_button_pixmap
  *	PARAMETERS:
  *          char *filename : filename to load ( XPM, PNG... )
  *	    Display *display: X11 display
+ *	    int size : side to scale the image to, 0 keeps its size
+ *	    XImage **ximage, **xmask : return the uploaded images, may be NULL
+ *
+ *	NOTE:
+ *		The images are only handed back for icons the built-in reader
+ *		decoded, otherwise *ximage is NULL. See xpmread_create_pixmap.
  *
  *	RETURN:
  *		XpmButton* : an XpmButton structure
  */
 int create_button_pixmap ( Display        *display,
 			   char           *filename,
+			   int             size,
 			   Pixmap         *pixmap,
 			   Pixmap         *pixmask,
-			   XpmAttributes  *xpmattributes );
+			   XpmAttributes  *xpmattributes,
+			   XImage        **ximage,
+			   XImage        **xmask );
+
+#if !HAVE_IMLIB2
+/* decode_button_image
+ *	PARAMETERS:
+ *          char *filename : XPM file to decode
+ *	    DecodedXpm *xpm : returns the decoded image
+ *
+ *	NOTE:
+ *		Client side only, safe to call from any thread. Free the
+ *		image with xpmread_free.
+ *
+ *	RETURN:
+ *		int : 0 on success, -1 on error, -2 if the file has to be
+ *		      left to libXpm
+ */
+int decode_button_image ( char *filename, DecodedXpm *xpm );
+
+/* upload_button_image
+ *	PARAMETERS:
+ *	    Display *display: X11 display
+ *	    DecodedXpm *xpm : image from decode_button_image
+ *	    int size : side to scale the image to, 0 keeps its size
+ *	    XImage **ximage, **xmask : return the uploaded images, may be NULL
+ *
+ *	NOTE:
+ *		Allocates the colors and creates the pixmaps, main thread only.
+ *
+ *	RETURN:
+ *		int : 0 on success, <0 on error
+ */
+int upload_button_image ( Display        *display,
+			  DecodedXpm     *xpm,
+			  int             size,
+			  Pixmap         *pixmap,
+			  Pixmap         *pixmask,
+			  XpmAttributes  *xpmattributes,
+			  XImage        **ximage,
+			  XImage        **xmask );
+
+/* preload_icon_images
+ *	PARAMETERS:
+ *          Display *display: X11 display
+ *          char **filenames : resolved paths of the icons about to be used
+ *          int count : number of paths
+ *
+ *	NOTE:
+ *		Decodes the icons that are neither loaded nor in the on-disk
+ *		cache on a pool of worker threads, acquire_icon_image then
+ *		only has to upload them. Imlib2 is not thread safe, so builds
+ *		with it don't have this and decode icons as they are acquired.
+ */
+void preload_icon_images ( Display *display, char **filenames, int count );
+#endif
+
+/* acquire_icon_image
+ *	PARAMETERS:
+ *          Display *display: X11 display
+ *          char *filename : filename to load ( XPM, PNG... )
+ *
+ *	NOTE:
+ *		Images are cached by file identity (device, inode,
+ *		modification and change time), so a file used by several
+ *		buttons, or reached through different paths, is decoded and
+ *		uploaded once. Every call must be matched by release_icon_image.
+ *
+ *	RETURN:
+ *		IconImage* : the shared image, NULL on error
+ */
+IconImage *acquire_icon_image ( Display *display, char *filename );
+
+/* release_icon_image
+ *	PARAMETERS:
+ *          Display *display: X11 display
+ *          IconImage *image : image from acquire_icon_image
+ *
+ *	NOTE:
+ *		The pixmaps are freed when the last user releases them.
+ */
+void release_icon_image ( Display *display, IconImage *image );
+
+/* icon_image_memory
+ *	RETURN:
+ *		unsigned long : estimated server memory held by all icon
+ *		                images, in bytes
+ */
+unsigned long icon_image_memory ( void );
 
 #endif
@@ -0,0 +1,632 @@
+/* rccache.c
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "rccache.h"
+#include "options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* the file starts with this header, the tables follow it, each starting
+ * on a CACHE_ALIGN boundary, and the strings come last */
+#define CACHE_MAGIC	"WMAPRC02"
+#define CACHE_ALIGN	8
+#define cache_align(n)	(((n) + CACHE_ALIGN - 1) & ~(size_t) (CACHE_ALIGN - 1))
+#define ICON_BUCKETS	256
+
+/* what a file or directory looked like, size is -1 for one that didn't
+ * exist, the times keep their nanoseconds so an edit within the second
+ * of the last start still shows */
+typedef struct {
+	int64_t  size;
+	int64_t  mtime, mtime_ns;
+	int64_t  ctime, ctime_ns;
+} CacheStamp;
+
+/* offsets of the tables are from the start of the file, offsets of
+ * strings are into the string block */
+typedef struct {
+	char     magic[8];
+	int64_t  rc_dev, rc_ino;	/* the rc file the tokens came from */
+	CacheStamp rc;
+	uint32_t size;			/* of the whole file */
+	uint32_t token_count, tokens;
+	uint32_t dir_count, dirs;
+	uint32_t icon_count, icons;
+	uint32_t strings, strings_size;
+	uint32_t cwd, colonpath;	/* where the icons were resolved */
+	uint32_t reserved;
+} CacheHeader;
+
+/* a line of the rc file, key is -1 for a section named by value */
+typedef struct {
+	int32_t  key, value;
+} CacheToken;
+
+typedef struct {
+	uint32_t name, path;
+} CacheIcon;
+
+typedef struct _CacheEntry_ {
+	char *name;
+	char *path;
+	int used;			/* looked up or resolved this session */
+	struct _CacheEntry_ *next;
+} CacheEntry;
+
+/* strings of the file being written */
+typedef struct {
+	char *data;
+	size_t size, alloc;
+} StringBlock;
+
+static int cache_state = 0;		/* 0 not opened, 1 open, <0 disabled */
+static int cache_dirty = 0;
+static char cache_path[4096];
+static void *cache_map = NULL;
+static size_t cache_map_size = 0;
+static CacheHeader *header = NULL;	/* NULL unless the file is sound */
+static struct stat rc_stat;
+static int rc_known = 0;		/* a file was passed to rccache_load */
+
+static CacheEntry *icon_table[ICON_BUCKETS];
+static CacheEntry *icon_pool = NULL;	/* entries of the mapped icons */
+static int icon_count = 0;
+static int icons_enabled = 0;		/* set by rccache_check_iconpath */
+static char *iconpath = NULL;
+static char cwd[4096];
+static CacheStamp *dirs = NULL;	/* the working directory, then the icon path */
+static int dir_count = 0;
+
+/* cache_stamp - what st says about a file */
+static void cache_stamp(struct stat *st, CacheStamp *stamp)
+{
+	stamp->size = st->st_size;
+	stamp->mtime = st->st_mtim.tv_sec;
+	stamp->mtime_ns = st->st_mtim.tv_nsec;
+	stamp->ctime = st->st_ctim.tv_sec;
+	stamp->ctime_ns = st->st_ctim.tv_nsec;
+}
+
+/* cache_string - string at offset in the mapped string block */
+static char *cache_string(uint32_t offset)
+{
+	return (char *) cache_map + header->strings + offset;
+}
+
+/* icon_hash - string hash for the icon table */
+static unsigned int icon_hash(const char *s)
+{
+	unsigned int h = 5381;
+
+	while(*s)
+		h = h * 33 + (unsigned char) *s++;
+
+	return h;
+}
+
+/* cache_find - finds the icon called name, NULL if there is none */
+static CacheEntry *cache_find(char *name)
+{
+	CacheEntry *e;
+
+	for(e = icon_table[icon_hash(name) & (ICON_BUCKETS - 1)]; e != NULL; e = e->next) {
+		if(strcmp(e->name, name) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+/* cache_insert - adds e to the icon table */
+static void cache_insert(CacheEntry *e)
+{
+	unsigned int bucket = icon_hash(e->name) & (ICON_BUCKETS - 1);
+
+	e->next = icon_table[bucket];
+	icon_table[bucket] = e;
+	icon_count++;
+}
+
+/* cache_table - checks that a table lies within the file */
+static int cache_table(uint32_t offset, uint32_t count, size_t size)
+{
+	return offset % CACHE_ALIGN == 0 && (uint64_t) offset + (uint64_t) count * size <= cache_map_size;
+}
+
+/* cache_sound - checks every offset in the mapped file, so nothing
+ * read through them later can leave the mapping */
+static int cache_sound(void)
+{
+	CacheHeader *h = (CacheHeader *) cache_map;
+	CacheToken *token;
+	CacheIcon *icon;
+	char *strings;
+	uint32_t i;
+
+	if(memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 || h->size != cache_map_size)
+		return 0;
+	if(!cache_table(h->tokens, h->token_count, sizeof(CacheToken)) ||
+	   !cache_table(h->dirs, h->dir_count, sizeof(CacheStamp)) ||
+	   !cache_table(h->icons, h->icon_count, sizeof(CacheIcon)) ||
+	   !cache_table(h->strings, h->strings_size, 1) || h->strings_size == 0)
+		return 0;
+
+	/* the last string ends the block, so every string is terminated */
+	strings = (char *) cache_map + h->strings;
+	if(strings[h->strings_size - 1] != '\0' || h->cwd >= h->strings_size || h->colonpath >= h->strings_size)
+		return 0;
+
+	token = (CacheToken *) ((char *) cache_map + h->tokens);
+	for(i = 0; i < h->token_count; i++) {
+		if(token[i].key < -1 || (token[i].key >= 0 && (uint32_t) token[i].key >= h->strings_size) ||
+		   token[i].value < 0 || (uint32_t) token[i].value >= h->strings_size)
+			return 0;
+	}
+
+	icon = (CacheIcon *) ((char *) cache_map + h->icons);
+	for(i = 0; i < h->icon_count; i++) {
+		if(icon[i].name >= h->strings_size || icon[i].path >= h->strings_size)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* cache_map_file - maps the cache file and indexes its icons, a file
+ * that doesn't check out is simply ignored */
+static void cache_map_file(void)
+{
+	CacheIcon *icon;
+	struct stat st;
+	uint32_t i;
+	int fd;
+
+	fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return;
+
+	if(fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(CacheHeader)) {
+		close(fd);
+		return;
+	}
+
+	cache_map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(cache_map == MAP_FAILED) {
+		cache_map = NULL;
+		return;
+	}
+	cache_map_size = st.st_size;
+
+	if(!cache_sound())
+		return;
+	header = (CacheHeader *) cache_map;
+
+	icon_pool = (CacheEntry *) malloc(sizeof(CacheEntry) * (header->icon_count + 1));
+	if(!icon_pool) {
+		fprintf(stderr, "rccache.c: Couldn't allocate cache entries.\n");
+		exit(1);
+	}
+
+	icon = (CacheIcon *) ((char *) cache_map + header->icons);
+	for(i = 0; i < header->icon_count; i++) {
+		icon_pool[i].name = cache_string(icon[i].name);
+		icon_pool[i].path = cache_string(icon[i].path);
+		icon_pool[i].used = 0;
+		cache_insert(&icon_pool[i]);
+	}
+}
+
+/* cache_open - sets up the cache of the rc file in rc_stat on first
+ * use, every rc file has its own, so instances started with different
+ * files don't replace each other's */
+static int cache_open(void)
+{
+	char *dir;
+	unsigned long long dev = rc_stat.st_dev, ino = rc_stat.st_ino;
+
+	if(cache_state != 0)
+		return cache_state;
+	cache_state = -1;
+
+	if((dir = getenv("XDG_CACHE_HOME")) != NULL && dir[0] == '/') {
+		if(snprintf(cache_path, sizeof(cache_path), "%s/wmappl/rc-%llx-%llx", dir, dev, ino) >= (int) sizeof(cache_path))
+			return cache_state;
+	}
+	else if((dir = getenv("HOME")) != NULL) {
+		if(snprintf(cache_path, sizeof(cache_path), "%s/.cache/wmappl/rc-%llx-%llx", dir, dev, ino) >= (int) sizeof(cache_path))
+			return cache_state;
+	}
+	else {
+		return cache_state;
+	}
+
+	cache_map_file();
+
+	cache_state = 1;
+	return cache_state;
+}
+
+/* rccache_load
+ *  PARAMETERS:
+ *      char *filename      : rc file about to be read
+ *  RETURN:
+ *      RCFile * : the cached file, NULL if it has to be parsed
+ */
+RCFile *rccache_load(char *filename)
+{
+	RCFile *rcfile;
+	RCToken *token;
+	CacheToken *cached;
+	CacheStamp stamp;
+	char *arena;
+	uint32_t i;
+
+	/* taken before the file is parsed, a later change makes it miss */
+	if(stat(filename, &rc_stat) < 0 || !S_ISREG(rc_stat.st_mode))
+		return NULL;
+	rc_known = 1;
+
+	if(cache_open() < 0)
+		return NULL;
+
+	cache_stamp(&rc_stat, &stamp);
+	if(header == NULL || header->rc_dev != (int64_t) rc_stat.st_dev ||
+	   header->rc_ino != (int64_t) rc_stat.st_ino || memcmp(&header->rc, &stamp, sizeof(stamp)) != 0) {
+		cache_dirty = 1;
+		return NULL;
+	}
+
+	/* the RCFile owns its arena, the strings are copied out in one go */
+	token = (RCToken *) malloc(sizeof(RCToken) * (header->token_count + 1));
+	arena = (char *) malloc(header->strings_size);
+	if(!token || !arena) {
+		fprintf(stderr, "rccache.c: Couldn't allocate space for the cached rcfile.\n");
+		exit(1);
+	}
+
+	cached = (CacheToken *) ((char *) cache_map + header->tokens);
+	for(i = 0; i < header->token_count; i++) {
+		token[i].key = cached[i].key;
+		token[i].value = cached[i].value;
+	}
+	memcpy(arena, cache_string(0), header->strings_size);
+
+	rcfile = rc_file_from_tokens(filename, arena, token, header->token_count);
+	free(token);
+
+	return rcfile;
+}
+
+/* cache_stat_dir - what a directory looks like */
+static void cache_stat_dir(char *path, CacheStamp *dir)
+{
+	struct stat st;
+
+	if(stat(*path ? path : ".", &st) == 0) {
+		cache_stamp(&st, dir);
+	}
+	else {
+		memset(dir, 0, sizeof(CacheStamp));
+		dir->size = -1;
+	}
+}
+
+/* rccache_check_iconpath
+ *  PARAMETERS:
+ *      char *colonpath     : icon path in effect
+ *  RETURN:
+ *      int : nonzero if the cached icons were kept
+ */
+int rccache_check_iconpath(char *colonpath)
+{
+	char *directory, *p;
+	int i, n, keep;
+
+	if(cache_state != 1 || getcwd(cwd, sizeof(cwd)) == NULL) {
+		memset(icon_table, 0, sizeof(icon_table));
+		icon_count = 0;
+		return 0;
+	}
+
+	iconpath = (char *) malloc(sizeof(char) * (strlen(colonpath) + 1));
+	directory = (char *) malloc(sizeof(char) * (strlen(colonpath) + 1));
+	for(dir_count = 2, p = colonpath; *p; p++) {
+		if(*p == PATHSEP)
+			dir_count++;
+	}
+	dirs = (CacheStamp *) malloc(sizeof(CacheStamp) * dir_count);
+	if(!iconpath || !directory || !dirs) {
+		fprintf(stderr, "rccache.c: Couldn't allocate the icon path.\n");
+		exit(1);
+	}
+	strcpy(iconpath, colonpath);
+
+	/* taken before any icon is resolved, a later change makes it miss */
+	cache_stat_dir(".", &dirs[0]);
+	for(i = 1, p = colonpath; i < dir_count; i++) {
+		for(n = 0; *p && *p != PATHSEP; p++)
+			directory[n++] = *p;
+		directory[n] = '\0';
+		if(*p)
+			p++;
+		cache_stat_dir(directory, &dirs[i]);
+	}
+	free(directory);
+
+	keep = header != NULL && header->dir_count == (uint32_t) dir_count &&
+	       strcmp(cache_string(header->cwd), cwd) == 0 &&
+	       strcmp(cache_string(header->colonpath), colonpath) == 0 &&
+	       memcmp((char *) cache_map + header->dirs, dirs, sizeof(CacheStamp) * dir_count) == 0;
+
+	/* resolved somewhere else, every icon is looked up again */
+	if(!keep) {
+		memset(icon_table, 0, sizeof(icon_table));
+		icon_count = 0;
+		cache_dirty = 1;
+	}
+
+	icons_enabled = 1;
+	return keep;
+}
+
+/* rccache_find_icon
+ *  PARAMETERS:
+ *      char *name          : icon name as given in the rc file
+ *  RETURN:
+ *      char * : newly allocated resolved path, NULL if it isn't cached
+ */
+char *rccache_find_icon(char *name)
+{
+	CacheEntry *e;
+	char *s;
+
+	if(!icons_enabled || (e = cache_find(name)) == NULL)
+		return NULL;
+	e->used = 1;
+
+	s = (char *) malloc(sizeof(char) * (strlen(e->path) + 1));
+	if(!s) {
+		fprintf(stderr, "rccache.c: Couldn't allocate string.\n");
+		exit(1);
+	}
+	strcpy(s, e->path);
+
+	return s;
+}
+
+/* rccache_add_icon
+ *  PARAMETERS:
+ *      char *name          : icon name as given in the rc file
+ *      char *path          : the path it was resolved to
+ */
+void rccache_add_icon(char *name, char *path)
+{
+	CacheEntry *e;
+	size_t name_length, path_length;
+
+	if(!icons_enabled || strchr(name, DIRSEP) != NULL || cache_find(name) != NULL)
+		return;
+
+	/* entry and strings share one allocation */
+	name_length = strlen(name) + 1;
+	path_length = strlen(path) + 1;
+	e = (CacheEntry *) malloc(sizeof(CacheEntry) + name_length + path_length);
+	if(!e) {
+		fprintf(stderr, "rccache.c: Couldn't allocate cache entry.\n");
+		exit(1);
+	}
+	e->name = (char *) (e + 1);
+	e->path = e->name + name_length;
+	memcpy(e->name, name, name_length);
+	memcpy(e->path, path, path_length);
+	e->used = 1;
+	cache_insert(e);
+
+	cache_dirty = 1;
+}
+
+/* block_add - appends s to the string block, returns its offset */
+static uint32_t block_add(StringBlock *b, char *s)
+{
+	size_t length = strlen(s) + 1;
+	uint32_t offset = (uint32_t) b->size;
+
+	if(b->size + length > b->alloc) {
+		while(b->size + length > b->alloc)
+			b->alloc = b->alloc ? b->alloc * 2 : 4096;
+		b->data = (char *) realloc(b->data, b->alloc);
+		if(!b->data) {
+			fprintf(stderr, "rccache.c: Couldn't grow the string block.\n");
+			exit(1);
+		}
+	}
+
+	memcpy(b->data + b->size, s, length);
+	b->size += length;
+
+	return offset;
+}
+
+/* cache_write - writes size bytes and pads them up to CACHE_ALIGN */
+static int cache_write(FILE *f, const void *data, size_t size)
+{
+	static const char zero[CACHE_ALIGN];
+
+	if(size > 0 && fwrite(data, size, 1, f) != 1)
+		return -1;
+	if(cache_align(size) != size && fwrite(zero, cache_align(size) - size, 1, f) != 1)
+		return -1;
+	return 0;
+}
+
+/* cache_mkdir - creates the directories leading to the cache file */
+static int cache_mkdir(char *path)
+{
+	char *p;
+
+	for(p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		if(mkdir(path, 0700) < 0 && errno != EEXIST) {
+			*p = '/';
+			return -1;
+		}
+		*p = '/';
+	}
+
+	return 0;
+}
+
+/* rccache_save
+ *  PARAMETERS:
+ *      RCFile *rcfile      : the file passed to rccache_load
+ */
+void rccache_save(RCFile *rcfile)
+{
+	CacheHeader h;
+	CacheToken *token;
+	CacheIcon *icon;
+	CacheEntry *e;
+	StringBlock block = { NULL, 0, 0 };
+	char temp[sizeof(cache_path) + 8];
+	FILE *f;
+	int i, j, n, fd, error = 0;
+	size_t size;
+
+	if(cache_state != 1 || !rc_known || rcfile == NULL)
+		return;
+
+	/* icons nobody asked for belong to entries that are gone */
+	for(i = 0; i < ICON_BUCKETS; i++) {
+		for(e = icon_table[i]; e != NULL; e = e->next) {
+			if(!e->used)
+				cache_dirty = 1;
+		}
+	}
+	if(!cache_dirty)
+		return;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+	h.rc_dev = rc_stat.st_dev;
+	h.rc_ino = rc_stat.st_ino;
+	cache_stamp(&rc_stat, &h.rc);
+
+	/* compile the sections and their keys into tokens */
+	h.token_count = rcfile->section_count;
+	for(i = 0; i < rcfile->section_count; i++)
+		h.token_count += rcfile->section[i]->key_count;
+	token = (CacheToken *) malloc(sizeof(CacheToken) * (h.token_count + 1));
+	icon = (CacheIcon *) malloc(sizeof(CacheIcon) * (icon_count + 1));
+	if(!token || !icon) {
+		fprintf(stderr, "rccache.c: Couldn't allocate space for the cache file.\n");
+		exit(1);
+	}
+
+	for(i = 0, n = 0; i < rcfile->section_count; i++) {
+		token[n].key = -1;
+		token[n++].value = block_add(&block, rcfile->section[i]->section_name);
+		for(j = 0; j < rcfile->section[i]->key_count; j++) {
+			token[n].key = block_add(&block, rcfile->section[i]->key[j]->key);
+			token[n++].value = block_add(&block, rcfile->section[i]->key[j]->value);
+		}
+	}
+
+	/* an unchecked icon path is stored empty, so it never matches */
+	h.cwd = block_add(&block, icons_enabled ? cwd : "");
+	h.colonpath = block_add(&block, icons_enabled ? iconpath : "");
+	h.dir_count = icons_enabled ? dir_count : 0;
+	for(i = 0; i < ICON_BUCKETS; i++) {
+		for(e = icon_table[i]; e != NULL; e = e->next) {
+			if(!e->used)
+				continue;
+			icon[h.icon_count].name = block_add(&block, e->name);
+			icon[h.icon_count++].path = block_add(&block, e->path);
+		}
+	}
+
+	h.tokens = cache_align(sizeof(CacheHeader));
+	h.dirs = h.tokens + cache_align(sizeof(CacheToken) * h.token_count);
+	h.icons = h.dirs + cache_align(sizeof(CacheStamp) * h.dir_count);
+	h.strings = h.icons + cache_align(sizeof(CacheIcon) * h.icon_count);
+	h.strings_size = block.size;
+	size = (size_t) h.strings + cache_align(block.size);
+	h.size = size;
+
+	/* offsets are 32 bits, tokens 31 */
+	if(size > INT32_MAX) {
+		free(token);
+		free(icon);
+		free(block.data);
+		return;
+	}
+
+	if(cache_mkdir(cache_path) < 0) {
+		fprintf(stderr, "rccache.c: Couldn't create the directory for %s.\n", cache_path);
+		free(token);
+		free(icon);
+		free(block.data);
+		return;
+	}
+
+	snprintf(temp, sizeof(temp), "%s.XXXXXX", cache_path);
+	fd = mkstemp(temp);
+	if(fd < 0 || (f = fdopen(fd, "w")) == NULL) {
+		if(fd >= 0) {
+			close(fd);
+			unlink(temp);
+		}
+		fprintf(stderr, "rccache.c: Couldn't write %s.\n", cache_path);
+		free(token);
+		free(icon);
+		free(block.data);
+		return;
+	}
+
+	error |= cache_write(f, &h, sizeof(h));
+	error |= cache_write(f, token, sizeof(CacheToken) * h.token_count);
+	error |= cache_write(f, dirs, sizeof(CacheStamp) * h.dir_count);
+	error |= cache_write(f, icon, sizeof(CacheIcon) * h.icon_count);
+	error |= cache_write(f, block.data, block.size);
+
+	if(fclose(f) != 0)
+		error = -1;
+
+	free(token);
+	free(icon);
+	free(block.data);
+
+	if(error || rename(temp, cache_path) < 0) {
+		unlink(temp);
+		fprintf(stderr, "rccache.c: Couldn't write %s.\n", cache_path);
+		return;
+	}
+
+	cache_dirty = 0;
+}
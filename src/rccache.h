@@ -0,0 +1,97 @@
+/* rccache.h
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __RCCACHE_H__
+#define __RCCACHE_H__
+
+#include "../config.h"
+#include "rcparser.h"
+
+/* rccache_load
+ *  PARAMETERS:
+ *      char *filename      : rc file about to be read
+ *
+ *  NOTE:
+ *      Every rc file has its own cache file, $XDG_CACHE_HOME/wmappl/rc-
+ *      followed by the device and inode of the rc file. It holds the
+ *      tokens of the rc file and the icons resolved for it, as offsets
+ *      into a single block of strings. It is memory-mapped and, if the
+ *      rc file still has the same size, modification and change time,
+ *      to the nanosecond, the RCFile is rebuilt from the tokens without
+ *      parsing any text.
+ *
+ *  RETURN:
+ *      RCFile * : the cached file, NULL if it has to be parsed
+ */
+RCFile *
+rccache_load(char *filename);
+
+/* rccache_check_iconpath
+ *  PARAMETERS:
+ *      char *colonpath     : icon path in effect
+ *
+ *  NOTE:
+ *      The cached icons are only kept if they were resolved from the
+ *      same working directory through the same icon path, and none of
+ *      those directories changed size, modification or change time
+ *      since. Must be called before rccache_find_icon.
+ *
+ *  RETURN:
+ *      int : nonzero if the cached icons were kept
+ */
+int
+rccache_check_iconpath(char *colonpath);
+
+/* rccache_find_icon
+ *  PARAMETERS:
+ *      char *name          : icon name as given in the rc file
+ *
+ *  RETURN:
+ *      char * : newly allocated resolved path, NULL if it isn't cached
+ */
+char *
+rccache_find_icon(char *name);
+
+/* rccache_add_icon
+ *  PARAMETERS:
+ *      char *name          : icon name as given in the rc file
+ *      char *path          : the path it was resolved to
+ *
+ *  NOTE:
+ *      Only plain file names are cached, names with a directory in them
+ *      are resolved on disk and can't be checked by their directory.
+ */
+void
+rccache_add_icon(char *name, char *path);
+
+/* rccache_save
+ *  PARAMETERS:
+ *      RCFile *rcfile      : the file passed to rccache_load
+ *
+ *  NOTE:
+ *      Rewrites the cache file if the rc file was parsed, icons were
+ *      resolved or cached icons went unused. Should be called once all
+ *      the icons have been resolved. Streamed rc files are not cached.
+ */
+void
+rccache_save(RCFile *rcfile);
+
+#endif /* not __RCCACHE_H__ */
@@ -20,6 +20,12 @@
 
 #include "rcparser.h"
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
 /* ----- TO DO -----
  * Error-handling : A system needs to be chosen for error handling.
  *                  Currently errors send a message to stderr and
@@ -59,7 +65,7 @@
  *           function is called, it calls realloc() to adjust
  *           the allocation size to the necessary sizes.
  *
- *     The following global variables track the multiplier for the
+ *     The following RCParser fields track the multiplier for the
  *     above allocation sizes. When the ALLOC size from the macro
  *     is exceeded, the multiplier is incremented. Allocation
  *     size is determined by multiplying the ALLOC macro with the
@@ -73,22 +79,54 @@
 #define ALLOC_KEYVALUE    16
 #define ALLOC_LINE        1024
 
-int             mult_section = 1;
-int             mult_keyvalue = 1;
-
-/* ----- INTERNAL GLOBAL VARIABLES ----- */
-
-FILE           *filehandle;		/* file handle for opened rcfile */
-int             end_of_file = 0;	/* set to 1 when eof is encountered */
-int             file_open = 0;	/* set to 1 in is opened */
-
-RCFile         *rcFile = NULL;
-RCSection      *rcSection = NULL;
-RCKeyValue     *rcKeyValue = NULL;
+/* ----- DEFAULT PARSER ----- */
+
+/* context used by the functions without an RCParser argument */
+static RCParser default_parser = { NULL, 0, 0, NULL, NULL, 1, 1 };
+
+/* names of the RCKnownKey ids, sorted */
+static char    *rc_key_names[RC_KEY_COUNT] = {
+	"background_color",
+	"background_icon",
+	"command",
+	"debug",
+	"icon",
+	"iconpath",
+	"lazy",
+	"name",
+	"pixmap_cache_kb",
+	"prefork",
+	"tooltip",
+	"tooltip_background",
+	"tooltip_delay",
+	"tooltip_font",
+	"tooltip_foreground",
+	"window"
+};
+
+static void     rc_build_index(RCFile *rcfile);
+static RCFile  *parse_rcfile_stdio(RCParser *ctx, char *filename);
+static RCFile  *rc_build_events(RCParser *ctx, char *filename, RCHandler *next);
+static RCFile  *parse_rcfile_mapped(char *filename, const char *map, size_t size);
 
 
 /* ----- USER FUNCTIONS ----- */
 
+/* rc_parser_init
+ *	PARAMETERS:
+ *      RCParser *ctx     : context to initialize
+ */
+void rc_parser_init(RCParser *ctx)
+{
+	ctx->filehandle = NULL;
+	ctx->end_of_file = 0;
+	ctx->file_open = 0;
+	ctx->rcfile = NULL;
+	ctx->section = NULL;
+	ctx->mult_section = 1;
+	ctx->mult_keyvalue = 1;
+}
+
 /* parse_rcfile
  *	PARAMETERS:
  *      char *filename    : name of rc file to parse
@@ -97,128 +135,447 @@ RCKeyValue     *rcKeyValue = NULL;
  */
 RCFile         *parse_rcfile(char *filename)
 {
-	char           *line, *name, *value;
-	int             i, j, line_length;
-	RCFile         *return_rcfile = NULL;
+	return rc_parse_file(&default_parser, filename);
+}
 
-	/* open the file */
-	open_file(filename, "r");
-	if(!file_open)
+/* rc_parse_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      char *filename    : name of rc file to parse
+ *	RETURN:
+ *      RCFile *          : returns RCFile structure for parsed file
+ */
+RCFile         *rc_parse_file(RCParser *ctx, char *filename)
+{
+	RCFile         *rcfile;
+	struct stat     st;
+	void           *map;
+	int             fd;
+
+	fd = open(filename, O_RDONLY);
+	if(fd < 0) {
+		fprintf(stderr, "rcparser.c: Couldn't open %s using mode %s.\n", filename, "r");
 		exit(1);
+	}
 
-	/* create the RCFile structure */
-	new_rcfile(filename);
+	/* pipes and the like are read the old way */
+	if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return parse_rcfile_stdio(ctx, filename);
+	}
 
-	while(!end_of_file) {
-		line = read_line();
+	if(st.st_size == 0) {
+		close(fd);
+		return parse_rcfile_mapped(filename, "", 0);
+	}
 
-		line_length = strlen(line);
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return parse_rcfile_stdio(ctx, filename);
 
-		/* check to see if this line is a section */
-		if(line_length > 0 && line[0] == '[' && line[line_length - 1] == ']') {
+	rcfile = parse_rcfile_mapped(filename, (const char *) map, st.st_size);
+	munmap(map, st.st_size);
 
-			/* allocate space for section name */
-			name = (char *) malloc(sizeof(char) * (line_length - 1));
-			if(!name) {
-				fprintf(stderr, "rcparser.c: Couldn't allocate space for section name.\n");
-				exit(1);
-			}
+	return rcfile;
+}
 
-			/* copy section name into allocated space */
-			for(i = 0; i < line_length - 2; i++) {
-				name[i] = line[i + 1];
-			}
+/* rc_dispatch_line
+ *  PARAMETERS:
+ *      char *line        : trimmed line from rc_read_line, cut in place
+ *      int *in_section   : set once a section has been seen
+ *      RCHandler *handler: receives the section or key-value pair
+ */
+static void rc_dispatch_line(char *line, int *in_section, RCHandler *handler)
+{
+	int             i, line_length;
+	char           *value, *end;
 
-			/* terminate section name */
-			name[i] = '\0';
+	line_length = strlen(line);
 
-			/* add section to RCFile */
-			new_rcsection(name);
+	/* check to see if this line is a section */
+	if(line_length > 0 && line[0] == '[' && line[line_length - 1] == ']') {
+		line[line_length - 1] = '\0';
+		*in_section = 1;
+		if(handler->on_section)
+			handler->on_section(line + 1, handler->data);
+	}
+	/* assume this is a key-value pair */
+	else if(line_length > 0) {
+		/* find first '=' character */
+		for(i = 0; i < line_length && line[i] != '='; i++);
+
+		if(i >= line_length) {
+			fprintf(stderr, "rcparser.c: Expected Key=Value, invalid file format.\n");
+			fprintf(stderr, "\t%s\n", line);
+			exit(1);
+		}
 
-			/* free section name */
-			free(name);
+		if(!*in_section) {
+			fprintf(stderr, "rcparser.c: An error occurred while reading rcfile.\n");
+			fprintf(stderr, "rcparser.c: Key=Value pairs must follow a [SECTION] line.\n");
+			exit(1);
 		}
-		/* assume this is a key-value pair */
-		else if(line_length > 0) {
-			/* find first '=' character */
-			for(i = 0; i < line_length && line[i] != '='; i++);
 
-			if(i >= line_length) {
-				fprintf(stderr, "rcparser.c: Expected Key=Value, invalid file format.\n");
-				fprintf(stderr, "\t%s\n", line);
-				exit(1);
-			}
+		/* trim the key and the value, a joined line may still end in
+		 * whitespace */
+		for(value = line + i + 1; is_whitespace(*value); value++);
+		for(end = line + line_length; end > value && is_whitespace(end[-1]); end--);
+		*end = '\0';
+		for(; i > 0 && is_whitespace(line[i - 1]); i--);
+		line[i] = '\0';
 
-			/* allocate space for key name */
-			name = (char *) malloc(sizeof(char) * (i + 1));
-			if(!name) {
-				fprintf(stderr, "rcparser.c: Couldn't allocate space for key name.\n");
-				exit(1);
-			}
+		if(handler->on_keyvalue)
+			handler->on_keyvalue(line, value, handler->data);
+	}
+}
 
-			/* copy key name into allocated space */
-			for(j = 0; j < i; j++) {
-				name[j] = line[j];
-			}
+/* rc_read_events - reports every line of the open file to handler */
+static void rc_read_events(RCParser *ctx, RCHandler *handler)
+{
+	char           *line;
+	int             in_section = 0;
 
-			/* terminate key name */
-			name[j] = '\0';
+	while(!ctx->end_of_file) {
+		line = rc_read_line(ctx);
+		if(!line)
+			break;
+		rc_dispatch_line(line, &in_section, handler);
+		free(line);
+	}
+}
 
-			/* trim key name */
-			name = trim_string(name);
+/* the handler building an RCFile in a parser context, passing the
+ * events on to another handler if there is one */
+typedef struct _RCBuilder_ {
+	RCParser       *ctx;
+	RCHandler      *next;
+} RCBuilder;
 
-			if(!name) {
-				fprintf(stderr, "rcparser.c: Couldn't trim key name.\n");
-				exit(1);
-			}
+static void build_section(char *name, void *data)
+{
+	RCBuilder      *builder = (RCBuilder *) data;
 
-			/* allocate space for key value */
-			value = (char *) malloc(sizeof(char) * (line_length - i));
-			if(!value) {
-				fprintf(stderr, "rcparser.c: Couldn't allocate space for key value.\n");
-				exit(1);
-			}
+	rc_new_section(builder->ctx, name);
+	if(builder->next && builder->next->on_section)
+		builder->next->on_section(name, builder->next->data);
+}
 
-			/* copy key value into allocated space */
-			for(j = i + 1; j < line_length; j++) {
-				value[j - i - 1] = line[j];
-			}
+static void build_keyvalue(char *key, char *value, void *data)
+{
+	RCBuilder      *builder = (RCBuilder *) data;
 
-			/* terminate key value */
-			value[j - i - 1] = '\0';
+	rc_new_keyvalue(builder->ctx, key, value);
+	if(builder->next && builder->next->on_keyvalue)
+		builder->next->on_keyvalue(key, value, builder->next->data);
+}
 
-			/* trim key value */
-			value = trim_string(value);
+/* rc_build_events - builds an RCFile from the open file */
+static RCFile  *rc_build_events(RCParser *ctx, char *filename, RCHandler *next)
+{
+	RCBuilder       builder;
+	RCHandler       handler;
+	RCFile         *return_rcfile;
 
-			if(!value) {
-				fprintf(stderr, "rcparser.c: Couldn't trim key value.\n");
-				exit(1);
+	builder.ctx = ctx;
+	builder.next = next;
+	handler.on_section = build_section;
+	handler.on_keyvalue = build_keyvalue;
+	handler.data = &builder;
+
+	/* create the RCFile structure */
+	rc_new_file(ctx, filename);
+
+	rc_read_events(ctx, &handler);
+
+	return_rcfile = ctx->rcfile;
+
+	/* clear the working RCFile and RCSection structures */
+	ctx->rcfile = NULL;
+	ctx->section = NULL;
+
+	/* reallocate the RCFile structure before returning */
+	realloc_rcfile(return_rcfile);
+
+	rc_build_index(return_rcfile);
+
+	return return_rcfile;
+}
+
+/* parse_rcfile_stdio - parses a file with read_line */
+static RCFile  *parse_rcfile_stdio(RCParser *ctx, char *filename)
+{
+	RCFile         *rcfile;
+
+	/* open the file */
+	rc_open_file(ctx, filename, "r");
+	if(!ctx->file_open)
+		exit(1);
+
+	rcfile = rc_build_events(ctx, filename, NULL);
+
+	rc_close_file(ctx);
+
+	return rcfile;
+}
+
+/* rc_stream_events
+ *	PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      FILE *stream      : stream to read, left open
+ *      RCHandler *handler: receives each section and key-value pair
+ *	RETURN:
+ *      none
+ */
+void rc_stream_events(RCParser *ctx, FILE *stream, RCHandler *handler)
+{
+	ctx->filehandle = stream;
+	ctx->file_open = 1;
+	ctx->end_of_file = 0;
+
+	rc_read_events(ctx, handler);
+
+	ctx->filehandle = NULL;
+	ctx->file_open = 0;
+}
+
+/* rc_parse_stream
+ *	PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      FILE *stream      : stream to read, left open
+ *      char *name        : name to store as the RCFile filename
+ *      RCHandler *handler: receives each line as it is read, or NULL
+ *	RETURN:
+ *      RCFile *          : returns RCFile structure for the stream
+ */
+RCFile         *rc_parse_stream(RCParser *ctx, FILE *stream, char *name, RCHandler *handler)
+{
+	RCFile         *rcfile;
+
+	ctx->filehandle = stream;
+	ctx->file_open = 1;
+	ctx->end_of_file = 0;
+
+	rcfile = rc_build_events(ctx, name, handler);
+
+	ctx->filehandle = NULL;
+	ctx->file_open = 0;
+
+	return rcfile;
+}
+
+/* rc_walk
+ *	PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      RCHandler *handler: receives each section and key-value pair
+ *	RETURN:
+ *      none
+ */
+void rc_walk(RCFile *rcfile, RCHandler *handler)
+{
+	int             i, j;
+
+	for(i = 0; i < rcfile->section_count; i++) {
+		if(handler->on_section)
+			handler->on_section(rcfile->section[i]->section_name, handler->data);
+		for(j = 0; j < rcfile->section[i]->key_count; j++) {
+			if(handler->on_keyvalue)
+				handler->on_keyvalue(rcfile->section[i]->key[j]->key, rcfile->section[i]->key[j]->value,
+									 handler->data);
+		}
+	}
+}
+
+/* parse_rcfile_mapped
+ *  PARAMETERS:
+ *      char *filename    : name of the file, kept for saving
+ *      char *map         : contents of the file
+ *      size_t size       : length of the contents
+ *
+ *  NOTES:
+ *      Follows the rules of read_line: '#' starts a comment outside of
+ *      double quotes, lines are trimmed and a trailing '\' joins the
+ *      next line. Lines are copied into the arena as they are scanned
+ *      and cut into section names, keys and values in place. Every
+ *      line loses at least its newline or gains only a terminator, so
+ *      the arena never needs more than size + 1 bytes.
+ */
+static RCFile  *parse_rcfile_mapped(char *filename, const char *map, size_t size)
+{
+	RCFile         *rcfile;
+	RCToken        *token = NULL;
+	const char     *p = map, *end = map + size;
+	char           *arena, *out, *start, *segment, *eq, *t;
+	int             token_count = 0, token_alloc = 0, inquote, newline;
+	int             section_count = 0;
+	long            key, value;
+
+	arena = (char *) malloc(size + 1);
+	if(!arena) {
+		fprintf(stderr, "rcparser.c: Couldn't allocate space for the rcfile arena.\n");
+		exit(1);
+	}
+	out = arena;
+
+	while(p < end) {
+		start = out;
+
+		/* copy one logical line, joining continued lines */
+		do {
+			segment = out;
+			inquote = 0;
+			newline = 0;
+
+			/* skip leading whitespace */
+			while(p < end && is_whitespace(*p))
+				p++;
+
+			while(p < end && *p != '\n' && !(*p == '#' && !inquote)) {
+				if(*p == '\"')
+					inquote = !inquote;
+				*out++ = *p++;
+			}
+
+			/* drop a comment */
+			while(p < end && *p != '\n')
+				p++;
+			if(p < end) {
+				newline = 1;
+				p++;
 			}
 
-			/* add key-value pair to RCSection */
-			new_rckeyvalue(name, value);
+			/* trim trailing whitespace */
+			while(out > segment && is_whitespace(out[-1]))
+				out--;
+
+			if(out == segment || out[-1] != '\\')
+				break;
+			out--;
+		} while(newline);
+
+		if(out == start)
+			continue;
+
+		/* a section */
+		if(start[0] == '[' && out[-1] == ']' && out - start >= 2) {
+			memmove(start, start + 1, out - start - 2);
+			out[-2] = '\0';
+			key = -1;
+			value = start - arena;
+			out--;
+			section_count++;
+		}
+		/* assume this is a key-value pair */
+		else {
+			/* a joined line may end in whitespace, the value is trimmed */
+			while(is_whitespace(out[-1]))
+				out--;
+			*out = '\0';
+			eq = strchr(start, '=');
+			if(!eq) {
+				fprintf(stderr, "rcparser.c: Expected Key=Value, invalid file format.\n");
+				fprintf(stderr, "\t%s\n", start);
+				exit(1);
+			}
+			if(section_count == 0) {
+				fprintf(stderr, "rcparser.c: An error occurred while reading rcfile.\n");
+				fprintf(stderr, "rcparser.c: Key=Value pairs must follow a [SECTION] line.\n");
+				exit(1);
+			}
 
-			/* free key name and key value */
-			free(name);
-			free(value);
+			/* the key ends before the whitespace in front of '=' */
+			for(t = eq; t > start && is_whitespace(t[-1]); t--);
+			*t = '\0';
+			for(t = eq + 1; is_whitespace(*t); t++);
+			key = start - arena;
+			value = t - arena;
+			out++;
+		}
 
+		/* remember the line */
+		if(token_count >= token_alloc) {
+			token_alloc = token_alloc ? token_alloc * 2 : 256;
+			token = (RCToken *) realloc(token, sizeof(RCToken) * token_alloc);
+			if(!token) {
+				fprintf(stderr, "rcparser.c: Couldn't grow token buffer.\n");
+				exit(1);
+			}
 		}
+		token[token_count].key = key;
+		token[token_count].value = value;
+		token_count++;
 	}
 
-	close_file();
+	rcfile = rc_file_from_tokens(filename, arena, token, token_count);
+	free(token);
 
-	return_rcfile = rcFile;
+	return rcfile;
+}
 
-	/* clear global rcFile, rcSection and rcKeyValue structures */
-	rcFile = NULL;
-	rcSection = NULL;
-	rcKeyValue = NULL;
+/* rc_file_from_tokens
+ *  PARAMETERS:
+ *      char *filename    : name to store as the RCFile filename
+ *      char *arena       : names and values, taken over
+ *      RCToken *token    : the lines of the file
+ *      int count         : number of tokens
+ *  RETURN:
+ *      RCFile *          : returns RCFile structure for the tokens
+ */
+RCFile         *rc_file_from_tokens(char *filename, char *arena, RCToken *token, int count)
+{
+	RCFile         *rcfile;
+	RCSection      *section = NULL;
+	int             i, section_count = 0, key_count = 0;
+
+	for(i = 0; i < count; i++) {
+		if(token[i].key < 0)
+			section_count++;
+		else
+			key_count++;
+	}
 
-	/* reallocate the RCFile structure before returning */
-	realloc_rcfile(return_rcfile);
+	/* allocate the RCFile structure and its pools */
+	rcfile = (RCFile *) malloc(sizeof(RCFile));
+	if(!rcfile) {
+		fprintf(stderr, "rcparser.c: Couldn't allocate space for an RCFile structure.\n");
+		exit(1);
+	}
+	rcfile->filename = (char *) malloc(sizeof(char) * (strlen(filename) + 1));
+	rcfile->section = (RCSection **) malloc(sizeof(RCSection *) * (section_count + 1));
+	rcfile->section_pool = (RCSection *) malloc(sizeof(RCSection) * (section_count + 1));
+	rcfile->key_pool = (RCKeyValue *) malloc(sizeof(RCKeyValue) * (key_count + 1));
+	rcfile->key_index = (RCKeyValue **) malloc(sizeof(RCKeyValue *) * (key_count + 1));
+	if(!rcfile->filename || !rcfile->section || !rcfile->section_pool || !rcfile->key_pool || !rcfile->key_index) {
+		fprintf(stderr, "rcparser.c: Couldn't allocate space for the RCFile structure.\n");
+		exit(1);
+	}
+	strcpy(rcfile->filename, filename);
+	rcfile->arena = arena;
+	rcfile->section_count = 0;
+
+	/* hand out the pools in file order */
+	key_count = 0;
+	for(i = 0; i < count; i++) {
+		if(token[i].key < 0) {
+			section = &rcfile->section_pool[rcfile->section_count];
+			section->section_name = arena + token[i].value;
+			section->key_count = 0;
+			section->key = &rcfile->key_index[key_count];
+			rcfile->section[rcfile->section_count++] = section;
+		}
+		else if(section) {
+			rcfile->key_pool[key_count].key = arena + token[i].key;
+			rcfile->key_pool[key_count].value = arena + token[i].value;
+			rcfile->key_pool[key_count].id = rc_key_id(rcfile->key_pool[key_count].key);
+			rcfile->key_index[key_count] = &rcfile->key_pool[key_count];
+			section->key_count++;
+			key_count++;
+		}
+	}
 
-	return return_rcfile;
+	rc_build_index(rcfile);
 
+	return rcfile;
 }
 
 /* save_rcfile
@@ -236,6 +593,18 @@ RCFile         *parse_rcfile(char *filename)
  *      then any comments in the original file will be lost.
  */
 void save_rcfile(RCFile *rcfile)
+{
+	rc_save_file(&default_parser, rcfile);
+}
+
+/* rc_save_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      RCFile *rcfile    : RCFile structure to save
+ *	RETURN:
+ *      none
+ */
+void rc_save_file(RCParser *ctx, RCFile *rcfile)
 {
 	int             i, j;
 
@@ -243,20 +612,20 @@ void save_rcfile(RCFile *rcfile)
 		return;
 
 	/* open the file */
-	open_file(rcfile->filename, "w");
-	if(!file_open)
+	rc_open_file(ctx, rcfile->filename, "w");
+	if(!ctx->file_open)
 		exit(1);
 
 	/* write a simple comment at the top */
-	fprintf(filehandle, "# %s : This file automatically generated by rcparser\n", rcfile->filename);
+	fprintf(ctx->filehandle, "# %s : This file automatically generated by rcparser\n", rcfile->filename);
 
 	for(i = 0; i < rcfile->section_count; i++) {
-		fprintf(filehandle, "\n[%s]\n", rcfile->section[i]->section_name);
+		fprintf(ctx->filehandle, "\n[%s]\n", rcfile->section[i]->section_name);
 		for(j = 0; j < rcfile->section[i]->key_count; j++)
-			fprintf(filehandle, "%s = %s\n", rcfile->section[i]->key[j]->key, rcfile->section[i]->key[j]->value);
+			fprintf(ctx->filehandle, "%s = %s\n", rcfile->section[i]->key[j]->key, rcfile->section[i]->key[j]->value);
 	}
 
-	close_file();
+	rc_close_file(ctx);
 
 }
 
@@ -270,9 +639,24 @@ void free_rcfile(RCFile *rcfile)
 {
 	int             i, j;
 
-	if(!rcFile)
+	if(!rcfile)
 		return;
 
+	free(rcfile->index);
+	free(rcfile->index_pool);
+
+	/* a mapped parse owns everything in a few blocks */
+	if(rcfile->arena) {
+		free(rcfile->arena);
+		free(rcfile->section_pool);
+		free(rcfile->key_pool);
+		free(rcfile->key_index);
+		free(rcfile->section);
+		free(rcfile->filename);
+		free(rcfile);
+		return;
+	}
+
 	for(i = 0; i < rcfile->section_count; i++) {
 		for(j = 0; j < rcfile->section[i]->key_count; j++) {
 			free(rcfile->section[i]->key[j]->key);
@@ -292,6 +676,174 @@ void free_rcfile(RCFile *rcfile)
 
 }
 
+/* rc_hash - hashes a section name, or a key within a section */
+static unsigned int rc_hash(char *section, char *key)
+{
+	unsigned int    h = 5381;
+
+	while(*section)
+		h = h * 33 + (unsigned char) *section++;
+	if(key) {
+		h = h * 33 + '=';
+		while(*key)
+			h = h * 33 + (unsigned char) *key++;
+	}
+
+	return h;
+}
+
+/* rc_index_find - returns the entry for section (and key), NULL if none */
+static RCIndexEntry *rc_index_find(RCFile *rcfile, unsigned int h, char *section, char *key)
+{
+	RCIndexEntry   *e;
+
+	for(e = rcfile->index[h & (rcfile->index_size - 1)]; e != NULL; e = e->next) {
+		if(e->hash != h || strcmp(e->section->section_name, section) != 0)
+			continue;
+		if(key == NULL ? e->keyvalue == NULL : (e->keyvalue != NULL && strcmp(e->keyvalue->key, key) == 0))
+			return e;
+	}
+
+	return NULL;
+}
+
+/* rc_build_index - indexes every section and key of rcfile, the first
+ * occurrence of each wins */
+static void rc_build_index(RCFile *rcfile)
+{
+	RCIndexEntry   *e;
+	RCSection      *section;
+	RCKeyValue     *keyvalue;
+	int             i, j, count = rcfile->section_count, n = 0;
+	unsigned int    h;
+
+	for(i = 0; i < rcfile->section_count; i++)
+		count += rcfile->section[i]->key_count;
+
+	for(rcfile->index_size = 16; rcfile->index_size < count; rcfile->index_size *= 2);
+	rcfile->index = (RCIndexEntry **) calloc(rcfile->index_size, sizeof(RCIndexEntry *));
+	rcfile->index_pool = (RCIndexEntry *) malloc(sizeof(RCIndexEntry) * (count + 1));
+	if(!rcfile->index || !rcfile->index_pool) {
+		fprintf(stderr, "rcparser.c: Couldn't allocate space for the rcfile index.\n");
+		exit(1);
+	}
+
+	for(i = 0; i < rcfile->section_count; i++) {
+		section = rcfile->section[i];
+		for(j = -1; j < section->key_count; j++) {
+			keyvalue = j < 0 ? NULL : section->key[j];
+			h = rc_hash(section->section_name, keyvalue ? keyvalue->key : NULL);
+			if(rc_index_find(rcfile, h, section->section_name, keyvalue ? keyvalue->key : NULL))
+				continue;
+
+			e = &rcfile->index_pool[n++];
+			e->hash = h;
+			e->section = section;
+			e->keyvalue = keyvalue;
+			e->next = rcfile->index[h & (rcfile->index_size - 1)];
+			rcfile->index[h & (rcfile->index_size - 1)] = e;
+		}
+	}
+}
+
+/* rc_get
+ *	PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      char *section     : section name
+ *      char *key         : key name
+ *	RETURN:
+ *      char *            : the value, NULL if there is none
+ */
+char           *rc_get(RCFile *rcfile, char *section, char *key)
+{
+	RCIndexEntry   *e;
+	int             i, j;
+
+	if(!rcfile)
+		return NULL;
+
+	if(!rcfile->index) {
+		/* not built by the parser, search it */
+		for(i = 0; i < rcfile->section_count; i++) {
+			if(strcmp(rcfile->section[i]->section_name, section) != 0)
+				continue;
+			for(j = 0; j < rcfile->section[i]->key_count; j++) {
+				if(strcmp(rcfile->section[i]->key[j]->key, key) == 0)
+					return rcfile->section[i]->key[j]->value;
+			}
+		}
+		return NULL;
+	}
+
+	e = rc_index_find(rcfile, rc_hash(section, key), section, key);
+	return e ? e->keyvalue->value : NULL;
+}
+
+/* rc_get_section
+ *	PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      char *name        : section name
+ *	RETURN:
+ *      RCSection *       : the first section of that name, NULL if none
+ */
+RCSection      *rc_get_section(RCFile *rcfile, char *name)
+{
+	RCIndexEntry   *e;
+	int             i;
+
+	if(!rcfile)
+		return NULL;
+
+	if(!rcfile->index) {
+		for(i = 0; i < rcfile->section_count; i++) {
+			if(strcmp(rcfile->section[i]->section_name, name) == 0)
+				return rcfile->section[i];
+		}
+		return NULL;
+	}
+
+	e = rc_index_find(rcfile, rc_hash(name, NULL), name, NULL);
+	return e ? e->section : NULL;
+}
+
+/* rc_key_id
+ *	PARAMETERS:
+ *      char *key         : key name
+ *	RETURN:
+ *      RCKnownKey        : id of the key, RC_KEY_UNKNOWN if unknown
+ */
+RCKnownKey rc_key_id(char *key)
+{
+	int             lo = 0, hi = RC_KEY_COUNT - 1, mid, c;
+
+	/* a binary search needs no state, so it is safe from any thread */
+	while(lo <= hi) {
+		mid = (lo + hi) / 2;
+		c = strcmp(key, rc_key_names[mid]);
+		if(c == 0)
+			return (RCKnownKey) mid;
+		if(c < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return RC_KEY_UNKNOWN;
+}
+
+/* rc_key_name
+ *	PARAMETERS:
+ *      RCKnownKey id     : id of a known key
+ *	RETURN:
+ *      char *            : the name of the key
+ */
+char           *rc_key_name(RCKnownKey id)
+{
+	if(id < 0 || id >= RC_KEY_COUNT)
+		return NULL;
+	return rc_key_names[id];
+}
+
 /* dump_rcfile
  *  PARAMETERS:
  *      RCFile *rcfile    : RCFile structure to dump to stderr
@@ -339,6 +891,18 @@ void dump_rcfile(RCFile *rcfile)
  *      it too will have it's following line appended. 
  */
 char           *read_line()
+{
+	return rc_read_line(&default_parser);
+}
+
+/* rc_read_line
+ *  PARAMETERS:
+ *      RCParser *ctx     : context of the file opened with rc_open_file
+ *
+ *	RETURN:
+ *      char *            : returns next line from file, as read_line
+ */
+char           *rc_read_line(RCParser *ctx)
 {
 	char           *line = NULL;
 	char           *return_line = NULL;
@@ -355,13 +919,13 @@ char           *read_line()
 	char_count = 0;
 
 	/* check to see if a file has been opened */
-	if(!file_open) {
+	if(!ctx->file_open) {
 		fprintf(stderr, "rcparser.c: A file must be opened before read_line() may be called.\n");
 		exit(1);
 	}
 
 	/* check to see that we have not already read EOF */
-	if(end_of_file) {
+	if(ctx->end_of_file) {
 		fprintf(stderr, "rcparser.c: EOF file has already been reached, cannot read_line().\n");
 		return NULL;
 	}
@@ -374,7 +938,7 @@ char           *read_line()
 	}
 
 	/* read in first character */
-	c = fgetc(filehandle);
+	c = fgetc(ctx->filehandle);
 
 	/* read characters into line until '#', '\n', or EOF */
 	while(c != EOF && c != '\n' && !(c == '#' && !inquote)) {
@@ -404,24 +968,24 @@ char           *read_line()
 		char_count++;
 
 		/* read in next character */
-		c = fgetc(filehandle);
+		c = fgetc(ctx->filehandle);
 	}
 
 	if(c == EOF)
-		end_of_file = 1;
+		ctx->end_of_file = 1;
 
 	/* terminate string with NULL character */
 	line[char_count] = '\0';
 
 	/* if the last character read was a '#' read until '\n' or EOF */
-	if((!end_of_file) && c == '#') {
+	if((!ctx->end_of_file) && c == '#') {
 		do {
-			c = fgetc(filehandle);
+			c = fgetc(ctx->filehandle);
 		} while(c != EOF && c != '\n');
 	}
 
 	if(c == EOF)
-		end_of_file = 1;
+		ctx->end_of_file = 1;
 
 	return_line = trim_string(line);
 
@@ -433,20 +997,20 @@ char           *read_line()
 	free(line);
 
 	/* if return_line ends in a '\' character, recurse and concatenate */
-	if(return_line[strlen(return_line) - 1] == '\\') {
+	if(return_line[0] != '\0' && return_line[strlen(return_line) - 1] == '\\') {
 
 		/* change the '\' character to a '\0' */
 		return_line[strlen(return_line) - 1] = '\0';
 
 		/* do not recurse if we have already read the EOF */
-		if(end_of_file)
+		if(ctx->end_of_file)
 			return return_line;
 
 		/* save return_line as this_line */
 		this_line = return_line;
 
 		/* recurse */
-		line = read_line();
+		line = rc_read_line(ctx);
 
 		/* if recursion returned NULL, return without concatenating */
 		if(!line)
@@ -480,26 +1044,39 @@ char           *read_line()
  *                          (see fopen man page)
  *
  *  NOTE:
- *      If the file is opened successfully, the global in FILE
- *      handle will point to the opened file. The file_open
- *      variable will also be set to 1.
+ *      If the file is opened successfully, the FILE handle of the
+ *      default RCParser will point to the opened file. Its file_open
+ *      field will also be set to 1.
  */
 void open_file(char *filename,
 			   char *mode)
 {
-	if(file_open) {
+	rc_open_file(&default_parser, filename, mode);
+}
+
+/* rc_open_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : context to open the file in
+ *      char *filename    : name of file to open
+ *      char *mode        : the mode to open the file in
+ */
+void rc_open_file(RCParser *ctx,
+				  char *filename,
+				  char *mode)
+{
+	if(ctx->file_open) {
 		fprintf(stderr, "rcparser.c: A file has already been opened, call close_file() first.\n");
 		return;
 	}
 
-	filehandle = fopen(filename, mode);
-	if(!filehandle) {
+	ctx->filehandle = fopen(filename, mode);
+	if(!ctx->filehandle) {
 		fprintf(stderr, "rcparser.c: Couldn't open %s using mode %s.\n", filename, mode);
 		return;
 	}
 
-	file_open = 1;
-	end_of_file = 0;
+	ctx->file_open = 1;
+	ctx->end_of_file = 0;
 
 }
 
@@ -513,9 +1090,18 @@ void open_file(char *filename,
  */
 void close_file()
 {
-	if(file_open) {
-		fclose(filehandle);
-		file_open = 0;
+	rc_close_file(&default_parser);
+}
+
+/* rc_close_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : context of the file to close
+ */
+void rc_close_file(RCParser *ctx)
+{
+	if(ctx->file_open) {
+		fclose(ctx->filehandle);
+		ctx->file_open = 0;
 	}
 }
 
@@ -528,35 +1114,55 @@ void close_file()
  *     space for RCSection pointers
  */
 void new_rcfile(char *filename)
+{
+	rc_new_file(&default_parser, filename);
+}
+
+/* rc_new_file
+ *  PARAMETERS:
+ *     RCParser *ctx  : context the RCFile is built in
+ *     char *filename : the name of the file associated with
+ *                      the rcfile (used for saving)
+ */
+void rc_new_file(RCParser *ctx, char *filename)
 {
 	/* reset the allocation multipliers */
-	mult_section = 1;
-	mult_keyvalue = 1;
+	ctx->mult_section = 1;
+	ctx->mult_keyvalue = 1;
 
 	/* allocate the new RCFile strucutre */
-	rcFile = (RCFile *) malloc(sizeof(RCFile));
-	if(!rcFile) {
+	ctx->rcfile = (RCFile *) malloc(sizeof(RCFile));
+	if(!ctx->rcfile) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space for an RCFile structure.\n");
 		exit(1);
 	}
 
 	/* allocate space for RCSection pointers */
-	rcFile->section = (RCSection **) malloc(sizeof(RCSection *) * ALLOC_SECTION);
-	if(!rcFile->section) {
+	ctx->rcfile->section = (RCSection **) malloc(sizeof(RCSection *) * ALLOC_SECTION);
+	if(!ctx->rcfile->section) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCFile structure for sections.\n");
 		exit(1);
 	}
 
 	/* allocate and store the filename */
-	rcFile->filename = (char *) malloc(sizeof(char) * (strlen(filename) + 1));
-	if(!rcFile->filename) {
+	ctx->rcfile->filename = (char *) malloc(sizeof(char) * (strlen(filename) + 1));
+	if(!ctx->rcfile->filename) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCFile structure for the filename.\n");
 		exit(1);
 	}
-	strcpy(rcFile->filename, filename);
+	strcpy(ctx->rcfile->filename, filename);
 
 	/* set section_count to zero */
-	rcFile->section_count = 0;
+	ctx->rcfile->section_count = 0;
+
+	/* the structures are allocated one by one */
+	ctx->rcfile->arena = NULL;
+	ctx->rcfile->section_pool = NULL;
+	ctx->rcfile->key_pool = NULL;
+	ctx->rcfile->key_index = NULL;
+	ctx->rcfile->index_size = 0;
+	ctx->rcfile->index = NULL;
+	ctx->rcfile->index_pool = NULL;
 
 }
 
@@ -575,57 +1181,67 @@ void new_rcfile(char *filename)
  *     added to the RCFile structure
  */
 void new_rcsection(char *name)
+{
+	rc_new_section(&default_parser, name);
+}
+
+/* rc_new_section
+ *  PARAMETERS:
+ *     RCParser *ctx : context with the working RCFile structure
+ *     char *name    : the name of the section to be added
+ */
+void rc_new_section(RCParser *ctx, char *name)
 {
 	int             section_index;
 
 	/* if new_rcfile hasn't been called error out */
-	if(!rcFile) {
+	if(!ctx->rcfile) {
 		fprintf(stderr, "rcparser.c: You must call new_rcfile before calling new_rcsection.\n");
 		exit(1);
 	}
 
 	/* check to see if rcFile.section needs to grow */
-	if(rcFile->section_count >= ALLOC_SECTION * mult_section) {
-		mult_section++;
-		rcFile->section = (RCSection **) realloc(rcFile->section, sizeof(RCSection *) * (ALLOC_SECTION * mult_section));
-		if(!rcFile->section) {
+	if(ctx->rcfile->section_count >= ALLOC_SECTION * ctx->mult_section) {
+		ctx->mult_section++;
+		ctx->rcfile->section = (RCSection **) realloc(ctx->rcfile->section, sizeof(RCSection *) * (ALLOC_SECTION * ctx->mult_section));
+		if(!ctx->rcfile->section) {
 			fprintf(stderr, "rcparser.c: Couldn't grow section buffer.\n");
 			exit(1);
 		}
 	}
 
 	/* allocate a new RCSection */
-	rcSection = (RCSection *) malloc(sizeof(RCSection));
-	if(!rcSection) {
+	ctx->section = (RCSection *) malloc(sizeof(RCSection));
+	if(!ctx->section) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space for an RCSection structure.\n");
 		exit(1);
 	}
 
 	/* reset the allocation multiplier */
-	mult_keyvalue = 1;
+	ctx->mult_keyvalue = 1;
 
 	/* allocate space for RCKeyValue pointers */
-	rcSection->key = (RCKeyValue **) malloc(sizeof(RCKeyValue *) * ALLOC_KEYVALUE);
-	if(!rcSection->key) {
+	ctx->section->key = (RCKeyValue **) malloc(sizeof(RCKeyValue *) * ALLOC_KEYVALUE);
+	if(!ctx->section->key) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCSection structure for keys.\n");
 		exit(1);
 	}
 
 	/* allocate and store section name */
-	rcSection->section_name = (char *) malloc(sizeof(char) * (strlen(name) + 1));
-	if(!rcSection->section_name) {
+	ctx->section->section_name = (char *) malloc(sizeof(char) * (strlen(name) + 1));
+	if(!ctx->section->section_name) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCSection structure for the section name.\n");
 		exit(1);
 	}
-	strcpy(rcSection->section_name, name);
+	strcpy(ctx->section->section_name, name);
 
 	/* set key_count to zero */
-	rcSection->key_count = 0;
+	ctx->section->key_count = 0;
 
 	/* add the section to rcFile */
-	section_index = rcFile->section_count;
-	rcFile->section[section_index] = rcSection;
-	rcFile->section_count++;
+	section_index = ctx->rcfile->section_count;
+	ctx->rcfile->section[section_index] = ctx->section;
+	ctx->rcfile->section_count++;
 
 }
 
@@ -646,50 +1262,67 @@ void new_rcsection(char *name)
 void new_rckeyvalue(char *name,
 					char *value)
 {
+	rc_new_keyvalue(&default_parser, name, value);
+}
+
+/* rc_new_keyvalue
+ *  PARAMETERS:
+ *     RCParser *ctx : context with the working RCSection structure
+ *     char *name    : the name of the key to be added
+ *     char *value   : the value to be associated with the key
+ */
+void rc_new_keyvalue(RCParser *ctx,
+					 char *name,
+					 char *value)
+{
+	RCKeyValue     *keyvalue;
+
 	/* if new_rcsection hasn't been called error out */
-	if(!rcSection) {
+	if(!ctx->section) {
 		fprintf(stderr, "rcparser.c: An error occurred while reading rcfile.\n");
 		fprintf(stderr, "rcparser.c: Key=Value pairs must follow a [SECTION] line.\n");
 		exit(1);
 	}
 
 	/* check to see if rcSection.key needs to grow */
-	if(rcSection->key_count >= ALLOC_KEYVALUE * mult_keyvalue) {
-		mult_keyvalue++;
-		rcSection->key =
-				(RCKeyValue **) realloc(rcSection->key, sizeof(RCKeyValue *) * (ALLOC_KEYVALUE * mult_keyvalue));
-		if(!rcSection->key) {
-			fprintf(stderr, "rcparser.c: Couldn't grow key buffer for section [%s].\n", rcSection->section_name);
+	if(ctx->section->key_count >= ALLOC_KEYVALUE * ctx->mult_keyvalue) {
+		ctx->mult_keyvalue++;
+		ctx->section->key =
+				(RCKeyValue **) realloc(ctx->section->key, sizeof(RCKeyValue *) * (ALLOC_KEYVALUE * ctx->mult_keyvalue));
+		if(!ctx->section->key) {
+			fprintf(stderr, "rcparser.c: Couldn't grow key buffer for section [%s].\n", ctx->section->section_name);
 			exit(1);
 		}
 	}
 
 	/* allocate a new RCKeyValue */
-	rcKeyValue = (RCKeyValue *) malloc(sizeof(RCKeyValue));
-	if(!rcKeyValue) {
+	keyvalue = (RCKeyValue *) malloc(sizeof(RCKeyValue));
+	if(!keyvalue) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space for an RCKeyValue structure.\n");
 		exit(1);
 	}
 
 	/* allocate and store key */
-	rcKeyValue->key = (char *) malloc(sizeof(char) * (strlen(name) + 1));
-	if(!rcKeyValue->key) {
+	keyvalue->key = (char *) malloc(sizeof(char) * (strlen(name) + 1));
+	if(!keyvalue->key) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCKeyValue structure for the key.\n");
 		exit(1);
 	}
-	strcpy(rcKeyValue->key, name);
+	strcpy(keyvalue->key, name);
 
 	/* allocate and store value */
-	rcKeyValue->value = (char *) malloc(sizeof(char) * (strlen(value) + 1));
-	if(!rcKeyValue->value) {
+	keyvalue->value = (char *) malloc(sizeof(char) * (strlen(value) + 1));
+	if(!keyvalue->value) {
 		fprintf(stderr, "rcparser.c: Couldn't allocate space in RCKeyValue structure for the value.\n");
 		exit(1);
 	}
-	strcpy(rcKeyValue->value, value);
+	strcpy(keyvalue->value, value);
+
+	keyvalue->id = rc_key_id(name);
 
 	/* add the key-value pair to rcSection */
-	rcSection->key[rcSection->key_count] = rcKeyValue;
-	rcSection->key_count++;
+	ctx->section->key[ctx->section->key_count] = keyvalue;
+	ctx->section->key_count++;
 
 }
 
@@ -829,13 +1462,14 @@ void realloc_rcfile(RCFile *rcfile)
 {
 	int             i;
 
-	if(rcfile == rcFile) {
+	if(rcfile == default_parser.rcfile) {
 		fprintf(stderr, "rcparser.c: realloc_rcfile() may not be called on an RCFile currently being parsed.\n");
 		return;
 	}
 
-	/* reallocate rcfile.section */
-	rcfile->section = (RCSection **) realloc(rcfile->section, sizeof(RCSection *) * (rcfile->section_count));
+	/* reallocate rcfile.section, keeping room for one so empty files
+	 * don't look like a failure */
+	rcfile->section = (RCSection **) realloc(rcfile->section, sizeof(RCSection *) * (rcfile->section_count ? rcfile->section_count : 1));
 	if(!rcfile->section) {
 		fprintf(stderr, "rcparser.c: Couldn't reallocate section array.\n");
 		exit(1);
@@ -844,7 +1478,7 @@ void realloc_rcfile(RCFile *rcfile)
 	/* reallocate each section.key */
 	for(i = 0; i < rcfile->section_count; i++) {
 		rcfile->section[i]->key =
-				(RCKeyValue **) realloc(rcfile->section[i]->key, sizeof(RCKeyValue *) * rcfile->section[i]->key_count);
+				(RCKeyValue **) realloc(rcfile->section[i]->key, sizeof(RCKeyValue *) * (rcfile->section[i]->key_count ? rcfile->section[i]->key_count : 1));
 		if(!rcfile->section[i]->key) {
 			fprintf(stderr, "rcparser.c: Couldn't reallocate key array.\n");
 			exit(1);
@@ -23,10 +23,38 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* ---- keys known to wmappl ----- */
+
+/* Every key is tagged with its id when it is parsed, so options can be
+ * bound with a switch instead of a strcmp per option. Kept in the
+ * sorted order of the names in rcparser.c. */
+typedef enum _RCKnownKey_ {
+    RC_KEY_UNKNOWN = -1,
+    RC_KEY_BACKGROUND_COLOR,
+    RC_KEY_BACKGROUND_ICON,
+    RC_KEY_COMMAND,
+    RC_KEY_DEBUG,
+    RC_KEY_ICON,
+    RC_KEY_ICONPATH,
+    RC_KEY_LAZY,
+    RC_KEY_NAME,
+    RC_KEY_PIXMAP_CACHE_KB,
+    RC_KEY_PREFORK,
+    RC_KEY_TOOLTIP,
+    RC_KEY_TOOLTIP_BACKGROUND,
+    RC_KEY_TOOLTIP_DELAY,
+    RC_KEY_TOOLTIP_FONT,
+    RC_KEY_TOOLTIP_FOREGROUND,
+    RC_KEY_WINDOW,
+    RC_KEY_COUNT
+} RCKnownKey;
+
+
 /* ---- RCFile, RCSection and RCKeyValue structures ----- */
 typedef struct _RCKeyValue_ {
     char *key;
     char *value;
+    RCKnownKey id;           /* RC_KEY_UNKNOWN for other keys */
 } RCKeyValue;
 
 typedef struct _RCSection_ {
@@ -35,24 +63,221 @@ typedef struct _RCSection_ {
     RCKeyValue **key;
 } RCSection;
 
+/* entry of the index of an RCFile, for a section or a key in it */
+typedef struct _RCIndexEntry_ {
+    unsigned int hash;
+    RCSection *section;
+    RCKeyValue *keyvalue;    /* NULL for the section itself */
+    struct _RCIndexEntry_ *next;
+} RCIndexEntry;
+
 typedef struct _RCFile_ {
     char *filename;
     int section_count;
     RCSection **section;
+
+    /* built by the parser, the first section of each name and the
+     * first value of each key in sections of that name */
+    int index_size;          /* number of buckets, a power of two */
+    RCIndexEntry **index;
+    RCIndexEntry *index_pool;
+
+    /* set when the file was parsed from a mapping, every string then
+     * lives in the arena and the structures in the two pools */
+    char *arena;
+    RCSection *section_pool;
+    RCKeyValue *key_pool;
+    RCKeyValue **key_index;
 } RCFile;
 
 
+/* a section or key-value line of a tokenized file, as offsets into its
+ * arena, key is -1 for a section whose name is at value */
+typedef struct _RCToken_ {
+    long key;
+    long value;
+} RCToken;
+
+
+/* ----- RCHandler callbacks ----- */
+
+/* Receives the contents of a file as it is parsed. Names, keys and
+ * values are only valid during the call, either callback may be NULL. */
+typedef struct _RCHandler_ {
+    void (*on_section)(char *name, void *data);
+    void (*on_keyvalue)(char *key, char *value, void *data);
+    void *data;              /* passed to both callbacks */
+} RCHandler;
+
+
+/* ----- RCParser context ----- */
+
+/* Everything a parse in progress needs. The functions taking an
+ * RCParser touch nothing else, so separate contexts can be used from
+ * separate threads at the same time. The functions without one share
+ * a single, internal context. */
+typedef struct _RCParser_ {
+    FILE *filehandle;        /* file handle for opened rcfile */
+    int end_of_file;         /* set to 1 when eof is encountered */
+    int file_open;           /* set to 1 if a file is opened */
+    RCFile *rcfile;          /* RCFile being built */
+    RCSection *section;      /* RCSection being built */
+    int mult_section;        /* allocation multipliers, see rcparser.c */
+    int mult_keyvalue;
+} RCParser;
+
+
 /* ----- USER FUNCTIONS ----- */
 
+/* rc_parser_init
+ *	PARAMETERS:
+ *      RCParser *ctx     : context to initialize, before its first use
+ */
+void
+rc_parser_init(RCParser *ctx);
+
+/* rc_parse_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      char *filename    : name of rc file to parse
+ *	RETURN:
+ *      RCFile *          : returns RCFile structure for parsed file
+ *
+ *  NOTES:
+ *      parse_rcfile with an explicit context.
+ */
+RCFile*
+rc_parse_file(RCParser *ctx, char *filename);
+
+/* rc_stream_events
+ *  PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      FILE *stream      : stream to read, it is not closed
+ *      RCHandler *handler: receives each section and key-value pair
+ *
+ *  NOTES:
+ *      Nothing is stored, each line is reported as soon as it has
+ *      been read, so a pipe can be handled while it is still being
+ *      written to.
+ */
+void
+rc_stream_events(RCParser *ctx, FILE *stream, RCHandler *handler);
+
+/* rc_parse_stream
+ *  PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      FILE *stream      : stream to read, it is not closed
+ *      char *name        : name to store as the RCFile filename
+ *      RCHandler *handler: receives each line as it is read, or NULL
+ *
+ *  RETURN:
+ *      RCFile *          : returns RCFile structure for the stream
+ */
+RCFile*
+rc_parse_stream(RCParser *ctx, FILE *stream, char *name, RCHandler *handler);
+
+/* rc_walk
+ *  PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      RCHandler *handler: receives each section and key-value pair
+ *
+ *  NOTES:
+ *      Reports an RCFile the way rc_stream_events reports a stream.
+ */
+void
+rc_walk(RCFile *rcfile, RCHandler *handler);
+
+/* rc_save_file
+ *  PARAMETERS:
+ *      RCParser *ctx     : parser context
+ *      RCFile *rcfile    : RCFile structure to save
+ *
+ *  NOTES:
+ *      save_rcfile with an explicit context.
+ */
+void
+rc_save_file(RCParser *ctx, RCFile *rcfile);
+
 /* parse_rcfile
  *	PARAMETERS:
  *      char *filename    : name of rc file to parse
  *	RETURN:
  *      RCFile *          : returns RCFile structure for parsed file
+ *
+ *  NOTES:
+ *      Regular files are memory mapped and tokenized in a single pass,
+ *      all names and values are stored in one arena, so the whole file
+ *      costs a handful of allocations. Anything that can't be mapped
+ *      is read a line at a time with read_line instead.
  */
 RCFile*
 parse_rcfile(char *filename);
 
+/* rc_file_from_tokens
+ *  PARAMETERS:
+ *      char *filename    : name to store as the RCFile filename
+ *      char *arena       : malloc'ed names and values, the RCFile takes
+ *                          it over
+ *      RCToken *token    : the lines of the file, in order
+ *      int count         : number of tokens
+ *
+ *  NOTES:
+ *      Builds an RCFile from a file that was tokenized before, the way
+ *      parse_rcfile does after its scan, without looking at any text.
+ *      Keys ahead of the first section are dropped. The tokens are
+ *      left to the caller.
+ *
+ *  RETURN:
+ *      RCFile *          : returns RCFile structure for the tokens
+ */
+RCFile*
+rc_file_from_tokens(char *filename, char *arena, RCToken *token, int count);
+
+/* rc_get
+ *  PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      char *section     : section name
+ *      char *key         : key name
+ *
+ *  RETURN:
+ *      char *            : the value of the first such key in a section
+ *                          of that name, NULL if there is none
+ */
+char*
+rc_get(RCFile *rcfile, char *section, char *key);
+
+/* rc_get_section
+ *  PARAMETERS:
+ *      RCFile *rcfile    : parsed file
+ *      char *name        : section name
+ *
+ *  RETURN:
+ *      RCSection *       : the first section of that name, NULL if none
+ */
+RCSection*
+rc_get_section(RCFile *rcfile, char *name);
+
+/* rc_key_id
+ *  PARAMETERS:
+ *      char *key         : key name
+ *
+ *  RETURN:
+ *      RCKnownKey        : id of the key, RC_KEY_UNKNOWN if it isn't
+ *                          one wmappl knows
+ */
+RCKnownKey
+rc_key_id(char *key);
+
+/* rc_key_name
+ *  PARAMETERS:
+ *      RCKnownKey id     : id of a known key
+ *
+ *  RETURN:
+ *      char *            : the name of the key
+ */
+char*
+rc_key_name(RCKnownKey id);
+
 /* save_rcfile
  *  PARAMETERS:
  *      RCFile *rcfile    : RCFile structure to save
@@ -114,18 +339,37 @@ dump_rcfile(RCFile *rcfile);
 char*
 read_line();
 
+/* rc_read_line
+ *  PARAMETERS:
+ *      RCParser *ctx     : context of the file opened with rc_open_file
+ *
+ *	RETURN:
+ *      char *            : returns next line from file, as read_line
+ */
+char*
+rc_read_line(RCParser *ctx);
+
 /* open_file
  *	PARAMETERS:
  *      char *filename    : name of file to open
  *
  *  NOTE:
- *      If the file is opened successfully, the global in FILE
- *      handle will point to the opened file. The file_open
- *      variable will also be set to 1.
+ *      If the file is opened successfully, the FILE handle of the
+ *      default RCParser will point to the opened file. Its file_open
+ *      field will also be set to 1.
  */
 void
 open_file(char *filename, char *mode);
 
+/* rc_open_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : context to open the file in
+ *      char *filename    : name of file to open
+ *      char *mode        : the mode to open the file in
+ */
+void
+rc_open_file(RCParser *ctx, char *filename, char *mode);
+
 /* close_file
  *	PARAMETERS:
  *      char *filename    : name of file to open
@@ -139,6 +383,13 @@ open_file(char *filename, char *mode);
 void
 close_file();
 
+/* rc_close_file
+ *	PARAMETERS:
+ *      RCParser *ctx     : context of the file to close
+ */
+void
+rc_close_file(RCParser *ctx);
+
 /* new_rcfile
  *  PARAMETERS:
  *     char *filename : the name of the file associated with
@@ -151,6 +402,15 @@ close_file();
 void
 new_rcfile(char *filename);
 
+/* rc_new_file
+ *  PARAMETERS:
+ *     RCParser *ctx  : context the RCFile is built in
+ *     char *filename : the name of the file associated with
+ *                      the rcfile (used for saving)
+ */
+void
+rc_new_file(RCParser *ctx, char *filename);
+
 /* new_rcsection
  *  PREREQUISITES:
  *     The new_rcfile function must have been called to create
@@ -167,6 +427,14 @@ new_rcfile(char *filename);
 void
 new_rcsection(char *name);
 
+/* rc_new_section
+ *  PARAMETERS:
+ *     RCParser *ctx : context with the working RCFile structure
+ *     char *name    : the name of the section to be added
+ */
+void
+rc_new_section(RCParser *ctx, char *name);
+
 /* new_rckeyvalue
  *  PREREQUISITES:
  *     The new_rcsection function must have been called to create
@@ -183,6 +451,15 @@ new_rcsection(char *name);
 void
 new_rckeyvalue(char *name, char *value);
 
+/* rc_new_keyvalue
+ *  PARAMETERS:
+ *     RCParser *ctx : context with the working RCSection structure
+ *     char *name    : the name of the key to be added
+ *     char *value   : the value to be associated with the key
+ */
+void
+rc_new_keyvalue(RCParser *ctx, char *name, char *value);
+
 /* set_rcfile_filename
  *  PARAMETERS:
  *      RCFile *rcfile    : the RCFile structure to set the filename for
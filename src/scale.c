@@ -0,0 +1,267 @@
+/* scale.c
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "scale.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#endif
+
+/* The filter runs in two passes, rows first. Channels are summed with
+ * integer weights that add up to the source size, the intermediate
+ * image keeps 7 fractional bits per channel in 16 bits, so the SSE2
+ * code can use pmaddwd to weigh two source pixels per instruction.
+ * Channel k of a pixel is bits 8k..8k+7 of its value, the byte order
+ * of x86 memory, which is what the SSE2 code sees. */
+
+/* the source pixels that make up each destination pixel along an axis */
+typedef struct _Filter_ {
+	int *first;		/* first source pixel */
+	int *count;		/* number of source pixels */
+	int *offset;		/* start of their weights in weight[] */
+	short *weight;		/* overlap of each, adds up to the source size */
+} Filter;
+
+static void filter_free(Filter *f)
+{
+	free(f->first);
+	free(f->count);
+	free(f->offset);
+	free(f->weight);
+}
+
+/* filter_build - source pixel i spans [i*m, (i+1)*m) and destination
+ * pixel j spans [j*n, (j+1)*n), the weights are the overlaps */
+static int filter_build(Filter *f, int n, int m)
+{
+	int i, j, k = 0, lo, hi;
+
+	f->first = (int *) malloc(sizeof(int) * m);
+	f->count = (int *) malloc(sizeof(int) * m);
+	f->offset = (int *) malloc(sizeof(int) * m);
+	f->weight = (short *) malloc(sizeof(short) * (n + m));
+	if(!f->first || !f->count || !f->offset || !f->weight) {
+		filter_free(f);
+		return -1;
+	}
+
+	for(j = 0; j < m; j++) {
+		f->first[j] = (int) ((long) j * n / m);
+		f->count[j] = (int) (((long) (j + 1) * n - 1) / m) - f->first[j] + 1;
+		f->offset[j] = k;
+		for(i = f->first[j]; i < f->first[j] + f->count[j]; i++) {
+			lo = (int) ((long) i * m > (long) j * n ? (long) i * m : (long) j * n);
+			hi = (int) ((long) (i + 1) * m < (long) (j + 1) * n ? (long) (i + 1) * m : (long) (j + 1) * n);
+			f->weight[k++] = (short) (hi - lo);
+		}
+	}
+
+	return 0;
+}
+
+/* scale_rows - weighs each row of src horizontally into tmp */
+static void scale_rows(const unsigned int *src, int sw, int sh, short *tmp, int dw, Filter *f)
+{
+	const unsigned int *row;
+	const short *weight;
+	int x, y, k, c, count;
+	int acc[4];
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128(), sum, v, w;
+#endif
+
+	for(y = 0; y < sh; y++) {
+		for(x = 0; x < dw; x++) {
+			row = src + (long) y * sw + f->first[x];
+			weight = f->weight + f->offset[x];
+			count = f->count[x];
+#ifdef USE_SSE2
+			sum = zero;
+			for(k = 0; k + 1 < count; k += 2) {
+				/* channels of both pixels side by side, 16 bits each */
+				v = _mm_loadl_epi64((const __m128i *) (row + k));
+				v = _mm_unpacklo_epi8(v, _mm_srli_si128(v, 4));
+				v = _mm_unpacklo_epi8(v, zero);
+				w = _mm_set1_epi32((unsigned short) weight[k] | ((unsigned int) weight[k + 1] << 16));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+			}
+			if(k < count) {
+				v = _mm_cvtsi32_si128((int) row[k]);
+				v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_set1_epi32(weight[k])));
+			}
+			_mm_storeu_si128((__m128i *) acc, sum);
+#else
+			acc[0] = acc[1] = acc[2] = acc[3] = 0;
+			for(k = 0; k < count; k++) {
+				for(c = 0; c < 4; c++)
+					acc[c] += (int) ((row[k] >> (8 * c)) & 0xff) * weight[k];
+			}
+#endif
+			for(c = 0; c < 4; c++)
+				tmp[((long) y * dw + x) * 4 + c] = (short) ((acc[c] * 128 + sw / 2) / sw);
+		}
+	}
+}
+
+/* scale_columns - weighs the columns of tmp vertically into dst */
+static void scale_columns(const short *tmp, int sh, unsigned int *dst, int dw, int dh, Filter *f)
+{
+	const short *column, *weight;
+	int x, y, k, c, count, alpha;
+	int acc[4];
+	unsigned int value;
+#ifdef USE_SSE2
+	__m128i zero = _mm_setzero_si128(), sum, a, b, w;
+#endif
+
+	for(y = 0; y < dh; y++) {
+		weight = f->weight + f->offset[y];
+		count = f->count[y];
+		for(x = 0; x < dw; x++) {
+			column = tmp + ((long) f->first[y] * dw + x) * 4;
+#ifdef USE_SSE2
+			sum = zero;
+			for(k = 0; k + 1 < count; k += 2) {
+				/* the same pixel of two rows, channels interleaved */
+				a = _mm_loadl_epi64((const __m128i *) (column + (long) k * dw * 4));
+				b = _mm_loadl_epi64((const __m128i *) (column + (long) (k + 1) * dw * 4));
+				w = _mm_set1_epi32((unsigned short) weight[k] | ((unsigned int) weight[k + 1] << 16));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+			}
+			if(k < count) {
+				a = _mm_loadl_epi64((const __m128i *) (column + (long) k * dw * 4));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), _mm_set1_epi32(weight[k])));
+			}
+			_mm_storeu_si128((__m128i *) acc, sum);
+#else
+			acc[0] = acc[1] = acc[2] = acc[3] = 0;
+			for(k = 0; k < count; k++) {
+				for(c = 0; c < 4; c++)
+					acc[c] += column[(long) k * dw * 4 + c] * weight[k];
+			}
+#endif
+			for(c = 0; c < 4; c++)
+				acc[c] = (acc[c] + sh * 64) / (sh * 128);
+
+			/* undo the premultiplication, channel 3 is alpha */
+			alpha = acc[3];
+			value = 0;
+			if(alpha > 0) {
+				value = (unsigned int) alpha << 24;
+				for(c = 0; c < 3; c++) {
+					acc[c] = (acc[c] * 255 + alpha / 2) / alpha;
+					value |= (unsigned int) (acc[c] > 255 ? 255 : acc[c]) << (8 * c);
+				}
+			}
+			dst[(long) y * dw + x] = value;
+		}
+	}
+}
+
+/* scale_argb
+ *  PARAMETERS:
+ *      unsigned int *src : premultiplied 0xAARRGGBB pixels
+ *      int sw, sh        : source size
+ *      unsigned int *dst : returns dw * dh pixels
+ *      int dw, dh        : destination size
+ *  RETURN:
+ *      int : 0 on success, -1 on error
+ */
+int scale_argb(const unsigned int *src, int sw, int sh, unsigned int *dst, int dw, int dh)
+{
+	Filter horizontal, vertical;
+	short *tmp;
+
+	if(sw < 1 || sh < 1 || dw < 1 || dh < 1 ||
+	   sw > SCALE_MAX_SIDE || sh > SCALE_MAX_SIDE || dw > SCALE_MAX_SIDE || dh > SCALE_MAX_SIDE)
+		return -1;
+
+	tmp = (short *) malloc(sizeof(short) * 4 * dw * sh);
+	if(!tmp)
+		return -1;
+	if(filter_build(&horizontal, sw, dw) < 0) {
+		free(tmp);
+		return -1;
+	}
+	if(filter_build(&vertical, sh, dh) < 0) {
+		filter_free(&horizontal);
+		free(tmp);
+		return -1;
+	}
+
+	scale_rows(src, sw, sh, tmp, dw, &horizontal);
+	scale_columns(tmp, sh, dst, dw, dh, &vertical);
+
+	filter_free(&horizontal);
+	filter_free(&vertical);
+	free(tmp);
+
+	return 0;
+}
+
+/* scale_alpha_to_mask
+ *  PARAMETERS:
+ *      unsigned int *argb  : 0xAARRGGBB pixels
+ *      int width, height   : image size
+ *      unsigned char *bits : returns the mask
+ *  RETURN:
+ *      int : non-zero if any pixel is transparent
+ */
+int scale_alpha_to_mask(const unsigned int *argb, int width, int height, unsigned char *bits)
+{
+	int x, y, n, bpl = (width + 7) / 8, transparent = 0;
+	unsigned char byte;
+
+	for(y = 0; y < height; y++) {
+		for(x = 0; x < width; x += 8) {
+			n = width - x < 8 ? width - x : 8;
+#ifdef USE_SSE2
+			if(n == 8) {
+				/* the top bit of each pixel is the alpha threshold */
+				byte = (unsigned char) (_mm_movemask_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i *) argb))) |
+				                        _mm_movemask_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (argb + 4)))) << 4);
+				argb += 8;
+			}
+			else
+#endif
+			{
+				int i;
+
+				byte = 0;
+				for(i = 0; i < n; i++, argb++) {
+					if(*argb & 0x80000000)
+						byte |= 1 << i;
+				}
+			}
+			if(byte != (0xff >> (8 - n)))
+				transparent = 1;
+			bits[y * bpl + x / 8] = byte;
+		}
+	}
+
+	return transparent;
+}
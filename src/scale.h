@@ -0,0 +1,67 @@
+/* scale.h
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __SCALE_H__
+#define __SCALE_H__
+
+#include "../config.h"
+
+/* largest source or destination side scale_argb accepts */
+#define SCALE_MAX_SIDE 32767
+
+/* scale_argb
+ *  PARAMETERS:
+ *      unsigned int *src : premultiplied 0xAARRGGBB pixels, row by row
+ *      int sw, sh        : source size
+ *      unsigned int *dst : returns dw * dh 0xAARRGGBB pixels, not
+ *                          premultiplied
+ *      int dw, dh        : destination size
+ *
+ *  NOTE:
+ *      Box (area) filter, every source pixel contributes in proportion
+ *      to how much of a destination pixel it covers, so it both shrinks
+ *      and enlarges. Uses SSE2 where the compiler targets it, otherwise
+ *      plain C; both give the same result. Doesn't touch the X server.
+ *
+ *  RETURN:
+ *      int : 0 on success, -1 on bad sizes or lack of memory
+ */
+int
+scale_argb(const unsigned int *src, int sw, int sh, unsigned int *dst, int dw, int dh);
+
+/* scale_alpha_to_mask
+ *  PARAMETERS:
+ *      unsigned int *argb   : 0xAARRGGBB pixels, row by row
+ *      int width, height    : image size
+ *      unsigned char *bits  : returns the mask, (width + 7) / 8 bytes
+ *                             per row, least significant bit first, as
+ *                             XCreateBitmapFromData expects it
+ *
+ *  NOTE:
+ *      Pixels with an alpha of 128 or more are set.
+ *
+ *  RETURN:
+ *      int : non-zero if any pixel is transparent
+ */
+int
+scale_alpha_to_mask(const unsigned int *argb, int width, int height, unsigned char *bits);
+
+#endif /* not __SCALE_H__ */
@@ -43,6 +43,9 @@
 #include "rcparser.h"
 #include "fileexists.h"
 #include "options.h"
+#include "launcher.h"
+#include "iconcache.h"
+#include "rccache.h"
 
 #define WMAPPLRC ".wmapplrc"
 #define SYSWMAPPLRC "/etc/wmapplrc"
@@ -52,9 +55,12 @@
 #define SCROLL_WHEEL_DOWN 5
 
 wmappl_opt *options = NULL;
+IconPath *iconpath = NULL;  /* only indexed once an icon isn't in the rc cache */
 
 XpmButton *icons, *sleft, *sright, *pressed;
 int clearwindow = 0;
+int scroll_columns = 0;  /* columns scrolled since the last paint, <0 is left */
+XpmButton *idle_button = NULL;  /* next button to load while idle, lazy mode */
 time_t last_pressed_time = (time_t) 0;  /* JWT:PREVENT KEY-REPEAT FOR FUNCTION-INVOCATION KEYS! */
 
 int button_positions[] = {
@@ -71,6 +77,25 @@ int scroll_positions[] = {
 	42, 46
 };
 
+/* geometry of the button area above, three columns of two buttons */
+#define BUTTON_AREA_X  5
+#define BUTTON_AREA_Y  5
+#define COLUMNS        3
+#define COLUMN_WIDTH   18
+#define COLUMN_HEIGHT  36
+
+
+/* load the visible buttons and a page to either side of them */
+void load_nearby_buttons() {
+	XpmButton *b;
+	int i;
+
+	for(i = 0, b = icons; i < 6 && b->last != NULL; i++, b = b->last)
+		;
+	for(i = 0; i < 18 && b != NULL; i++, b = b->next) {
+		load_xpmbutton(b, dockapp_get_display());
+	}
+}
 
 void set_button_positions() {
 	XpmButton *b;
@@ -79,13 +104,33 @@ void set_button_positions() {
 	for(i = 0, b = icons; i < 6 && b != NULL; i++, b = b->next) {
 		set_xpmbutton_position(b, button_positions[i * 2], button_positions[(i * 2) + 1]);
 	}
+
+	if(options->lazy && icons != NULL)
+		load_nearby_buttons();
+}
+
+/* load the remaining buttons one at a time while there is nothing else to do */
+int wmappl_idle() {
+	while(idle_button != NULL && idle_button->loaded)
+		idle_button = idle_button->next;
+
+	/* stop once everything is loaded or the pixmap budget is used up */
+	if(idle_button == NULL || xpmbutton_budget_full()) {
+		/* remember the decoded icons */
+		iconcache_save();
+		return 0;
+	}
+
+	load_xpmbutton(idle_button, dockapp_get_display());
+	idle_button = idle_button->next;
+	return 1;
 }
 
 /* scroll buttons left / move back 2 icons in list */
 int scroll_left() {
 	if(icons->last!=NULL && icons->last->last!=NULL) {
 		icons=icons->last->last;
-		clearwindow=1;
+		scroll_columns--;
 		set_button_positions();
 		return 1;
 	}
@@ -101,7 +146,7 @@ int scroll_right() {
 		&& icons->next->next->next->next->next!=NULL
 		&& icons->next->next->next->next->next->next!=NULL) {
 			icons=icons->next->next;
-			clearwindow=1;
+			scroll_columns++;
 			set_button_positions();
 			return 1;
 	}
@@ -149,26 +194,94 @@ char * wmappl_tooltip(int x, int y) {
 }
 #endif
 
+/* shift the columns that stay visible after scrolling inside the back
+ * buffer, so only the newly exposed columns have to be drawn; returns 0
+ * if everything has to be drawn instead */
+int blit_scroll(Drawable drw, int columns) {
+	XpmButton *p;
+	int i, kept, x;
+
+	/* a background icon may not line up after the shift */
+	if(options->bgicon != NULL || abs(columns) >= COLUMNS)
+		return 0;
+
+	kept = COLUMNS - abs(columns);
+
+	if(columns > 0) {
+		/* scrolled right, pixels move left */
+		dockapp_copy_area(BUTTON_AREA_X + columns * COLUMN_WIDTH, BUTTON_AREA_Y,
+		                  kept * COLUMN_WIDTH, COLUMN_HEIGHT, BUTTON_AREA_X, BUTTON_AREA_Y);
+		x = BUTTON_AREA_X + kept * COLUMN_WIDTH;
+	}
+	else {
+		dockapp_copy_area(BUTTON_AREA_X, BUTTON_AREA_Y, kept * COLUMN_WIDTH, COLUMN_HEIGHT,
+		                  BUTTON_AREA_X - columns * COLUMN_WIDTH, BUTTON_AREA_Y);
+		x = BUTTON_AREA_X;
+	}
+
+	/* the new columns start out empty, there may be no button to draw */
+	dockapp_draw_background(drw, x, BUTTON_AREA_Y, abs(columns) * COLUMN_WIDTH, COLUMN_HEIGHT,
+	                        x, BUTTON_AREA_Y);
+	dockapp_damage(x, BUTTON_AREA_Y, abs(columns) * COLUMN_WIDTH, COLUMN_HEIGHT);
+
+	/* draw exactly the buttons of the new columns */
+	for(i = 0, p = icons; i < 6 && p != NULL; i++, p = p->next) {
+		if(columns > 0 ? i / 2 >= kept : i / 2 < -columns)
+			p->dirty = 1;
+		else if(!p->pressed)
+			p->dirty = 0;
+	}
+
+	return 1;
+}
+
+/* draw a button if it changed (or everything has been cleared) */
+void paint_xpmbutton(XpmButton *p, Display * dsp, Drawable drw, GC gc, int all) {
+	if(p == NULL || !(all || p->dirty))
+		return;
+	draw_xpmbutton(p, dsp, drw, gc);
+	dockapp_damage(p->x, p->y, p->width, p->height);
+}
+
 /* paint callback */
 void wmappl_paint(Display * dsp, Drawable drw, GC gc) {
 	XpmButton *p;
-	int i;
+	int i, all = 0;
+
+	/* shift the buttons that are still visible after scrolling */
+	if(!clearwindow && scroll_columns != 0 && !blit_scroll(drw, scroll_columns))
+		clearwindow = 1;
+	scroll_columns = 0;
 
 	/* clear the window if needed */
 	if(clearwindow) {
 		dockapp_clear();
 		/* reset the clearwindow variable */
 		clearwindow = 0;
+		all = 1;
 	}
 
 	/* draw the six visible buttons */
 	for(i = 0, p = icons; i < 6 && p != NULL; i++, p = p->next)
-		draw_xpmbutton(p, dsp, drw, gc);
+		paint_xpmbutton(p, dsp, drw, gc, all);
 
 	/* draw the scroll buttons */
-	draw_xpmbutton(sleft, dsp, drw, gc);
-	draw_xpmbutton(sright, dsp, drw, gc);
+	paint_xpmbutton(sleft, dsp, drw, gc, all);
+	paint_xpmbutton(sright, dsp, drw, gc, all);
+
+}
 
+/* execute the command associated with a button */
+void execute_xpmbutton(XpmButton *b) {
+	if(options->debugmode) {
+		fprintf(stderr, "Execute command: %s%s\n", b->command, b->argv ? "" : " (via /bin/sh)");
+	}
+	else if(b->argv) {
+		launch_argv(b->argv);
+	}
+	else {
+		launch_command(b->command);
+	}
 }
 
 /* JWT:Invoke button at (relative-to the six displayed) offset (0-5): */
@@ -191,10 +304,7 @@ void press_iconbtn(int icon_offset, int s) {
 	if (p != NULL && p->command != NULL) {
 		if (s == MOUSE_RELEASED) {
 			last_pressed_time = time (NULL);
-			if(options->debugmode)
-				fprintf(stderr, "Execute command: %s\n", p->command);
-			else
-				system(p->command);
+			execute_xpmbutton(p);
 		}
 		set_xpmbutton_pressed(p, s);
 	}
@@ -270,12 +380,7 @@ void wmappl_mouse(int x, int y, int z, int s) {
 			/* execute command associated with button */
 			else {
 				if(pressed->command != NULL) {
-					if(options->debugmode) {
-						fprintf(stderr, "Execute command: %s\n", pressed->command);
-					}
-					else {
-						system(pressed->command);
-					}
+					execute_xpmbutton(pressed);
 				}
 			}
 
@@ -350,55 +455,21 @@ void wmappl_keyboard(char kc, KeySym ks, int s) {
 		dockapp_redraw();
 }
 
-char * get_abspath_to_icon(char *filename, IconPath *iconpath) {
-	char *abspath;
-	int i;
-
-	if(!filename || !iconpath)
-		return (char *) NULL;
-
-
-	/* check if filename is absolute path */
-	if(fileexists(filename)) {
-
-		/* allocate return value */
-		abspath = (char *) malloc(sizeof(char) * (strlen(filename) + 1));
-		if(!abspath) {
-			fprintf(stderr, "wmappl.c: Couldn't allocate string.\n");
-			exit(1);
-		}
-
-		/* copy the filename into the return value */
-		strcpy(abspath, filename);
-
-		return abspath;
-	}
-
-	abspath = (char *) malloc(iconpath->dirallocsize + (sizeof(char) * strlen(filename)));
-
-	/* try each directory in the IconPath structure */
-	for(i = 0; i < iconpath->count; i++) {
-
-		/* copy the directory into the absolute path */
-		strcpy(abspath, iconpath->path[i]);
-		strcat(abspath, filename);
-
-		/* check to see if filename exists at the absolute path */
-		if(fileexists(abspath)) {
-
-			/* reallocate return value to it's proper size */
-			abspath = (char *) realloc(abspath, sizeof(char) * (strlen(abspath) + 1));
-			if(!abspath) {
-				fprintf(stderr, "wmappl.c: Couldn't reallocate string.\n");
-				exit(1);
-			}
-
-			return abspath;
-		}
+char * get_abspath_to_icon(char *filename) {
+	char *s;
 
-	}
+	/* resolved at an earlier start */
+	s = rccache_find_icon(filename);
+	if(s!=NULL)
+		return s;
 
-	return (char *) NULL;
+	/* index the icon path on the first miss */
+	if(iconpath==NULL)
+		iconpath = opt_create_iconpath(options->colonpath);
+	s = opt_find_icon(iconpath, filename);
+	if(s!=NULL)
+		rccache_add_icon(filename, s);
+	return s;
 }
 
 char *default_rcfile() {
@@ -425,27 +496,134 @@ char *default_rcfile() {
 }
 
 
+/* copy_value - returns a copy of an rc file value */
+char *copy_value(char *value) {
+	char *s = (char *) malloc(sizeof(char) * (strlen(value) + 1));
+
+	if(s==NULL) {
+		fprintf(stderr, "wmappl.c (error) : malloc()\n");
+		exit(1);
+	}
+	strcpy(s, value);
+	return s;
+}
+
+/* rc_option - applies a key of the [wmappl] section, anything set on
+ * the command line or earlier in the file is kept */
+void rc_option(RCKnownKey id, char *value) {
+	switch(id) {
+		case RC_KEY_ICONPATH:
+			if(options->colonpath==NULL) options->colonpath=copy_value(value);
+			break;
+		case RC_KEY_NAME:
+			if(options->name==NULL) options->name=copy_value(value);
+			break;
+		case RC_KEY_BACKGROUND_COLOR:
+			if(options->bgcolor==NULL) options->bgcolor=copy_value(value);
+			break;
+		case RC_KEY_BACKGROUND_ICON:
+			if(options->bgicon==NULL) options->bgicon=copy_value(value);
+			break;
+		case RC_KEY_DEBUG:
+			if(options->debugmode<0) options->debugmode=1;
+			break;
+		case RC_KEY_WINDOW:
+			if(options->withdrawn<0) options->withdrawn=0;
+			break;
+		case RC_KEY_PREFORK:
+			if(options->prefork<0) options->prefork=1;
+			break;
+		case RC_KEY_LAZY:
+			if(options->lazy<0) options->lazy=1;
+			break;
+		case RC_KEY_PIXMAP_CACHE_KB:
+			if(options->pixmap_cache_kb<0) options->pixmap_cache_kb=atoi(value);
+			break;
+#ifdef USE_TOOLTIPS
+		case RC_KEY_TOOLTIP_DELAY:
+			if(options->tooltipDelay<0) options->tooltipDelay=atoi(value);
+			break;
+		case RC_KEY_TOOLTIP_FOREGROUND:
+			if(options->tooltipfg==NULL) options->tooltipfg=copy_value(value);
+			break;
+		case RC_KEY_TOOLTIP_BACKGROUND:
+			if(options->tooltipbg==NULL) options->tooltipbg=copy_value(value);
+			break;
+		case RC_KEY_TOOLTIP_FONT:
+			if(options->tooltipfont==NULL) options->tooltipfont=copy_value(value);
+			break;
+#endif
+		default:
+			break;
+	}
+}
+
+/* rc file callbacks, data points to a flag telling whether the current
+ * section is [wmappl] */
+void rc_section(char *name, void *data) {
+	*(int *) data = strcmp(name, "wmappl")==0;
+}
+
+void rc_keyvalue(char *key, char *value, void *data) {
+	if(*(int *) data)
+		rc_option(rc_key_id(key), value);
+}
+
+/* load_rcfile - an unchanged file comes from the rc cache */
+RCFile *load_rcfile(RCParser *parser, char *fn) {
+	RCFile *rcfile = rccache_load(fn);
+
+	if(rcfile==NULL)
+		rcfile = rc_parse_file(parser, fn);
+	return rcfile;
+}
+
 RCFile *read_rcfile(char *fn) {
 	RCFile *rcfile = NULL;
-	char *t;
-	int i, j, l;
+	RCParser parser;
+	RCHandler handler;
+	FILE *stream;
+	char *t, *value;
+	int in_wmappl = 0, id;
+
+	handler.on_section = rc_section;
+	handler.on_keyvalue = rc_keyvalue;
+	handler.data = &in_wmappl;
+	rc_parser_init(&parser);
+
+	/* generated configs are streamed, options apply as they arrive */
+	if(options->rcexec!=NULL) {
+		stream = popen(options->rcexec, "r");
+		if(stream==NULL) {
+			fprintf(stderr, "wmappl could not run the rc command you specified: %s\n", options->rcexec);
+			exit(1);
+		}
+		rcfile = rc_parse_stream(&parser, stream, options->rcexec, &handler);
+		if(pclose(stream)!=0) {
+			fprintf(stderr, "wmappl.c: Warning, %s did not exit successfully.\n", options->rcexec);
+		}
+		return rcfile;
+	}
+	if(fn!=NULL && strcmp(fn, "-")==0) {
+		return rc_parse_stream(&parser, stdin, fn, &handler);
+	}
 
 	if(fn!=NULL) {
 		if(!fileexists(fn)) {
 			fprintf(stderr, "wmappl could not find the rc file you specified: %s\n", fn);
 			exit(1);
 		}
-		rcfile = parse_rcfile(fn);
+		rcfile = load_rcfile(&parser, fn);
 	}
 	else {
 		t=default_rcfile();
 		if(t!=NULL && fileexists(t)) {
 			/* try HOME/WMAPPLRC */
-			rcfile = parse_rcfile(t);
+			rcfile = load_rcfile(&parser, t);
 		}
 		else if(fileexists(SYSWMAPPLRC)) {
 			/* try SYSWMAPPLRC */
-			rcfile = parse_rcfile(SYSWMAPPLRC);
+			rcfile = load_rcfile(&parser, SYSWMAPPLRC);
 		}
 		if(t!=NULL) free(t);
 	}
@@ -456,63 +634,57 @@ RCFile *read_rcfile(char *fn) {
 		exit(1);
 	}
 
-	/* spin through rcfile looking for a wmappl section */
-	for(i=0; i<rcfile->section_count; i++) {
-		if(strcmp(rcfile->section[i]->section_name, "wmappl")==0) {
-			for(j = 0; j < rcfile->section[i]->key_count; j++) {
-				if(options->colonpath==NULL && strcmp(rcfile->section[i]->key[j]->key, "iconpath") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->colonpath=(char *)malloc(sizeof(char)*l);
-					strncpy(options->colonpath, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->name==NULL && strcmp(rcfile->section[i]->key[j]->key, "name") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->name=(char *)malloc(sizeof(char)*l);
-					strncpy(options->name, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->bgcolor==NULL && strcmp(rcfile->section[i]->key[j]->key, "background_color") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->bgcolor=(char *)malloc(sizeof(char)*l);
-					strncpy(options->bgcolor, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->bgicon==NULL && strcmp(rcfile->section[i]->key[j]->key, "background_icon") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->bgicon=(char *)malloc(sizeof(char)*l);
-					strncpy(options->bgicon, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->debugmode<0 && strcmp(rcfile->section[i]->key[j]->key, "debug") == 0) {
-					options->debugmode=1;
-				}
-				if(options->withdrawn<0 && strcmp(rcfile->section[i]->key[j]->key, "window") == 0) {
-					options->withdrawn=0;
-				}
-#ifdef USE_TOOLTIPS
-				if(options->tooltipDelay<0 && strcmp(rcfile->section[i]->key[j]->key, "tooltip_delay") == 0) {
-					options->tooltipDelay=atoi(rcfile->section[i]->key[j]->value);
-				}
-				if(options->tooltipfg==NULL && strcmp(rcfile->section[i]->key[j]->key, "tooltip_foreground") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->tooltipfg=(char *)malloc(sizeof(char)*l);
-					strncpy(options->tooltipfg, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->tooltipbg==NULL && strcmp(rcfile->section[i]->key[j]->key, "tooltip_background") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->tooltipbg=(char *)malloc(sizeof(char)*l);
-					strncpy(options->tooltipbg, rcfile->section[i]->key[j]->value, l);
-				}
-				if(options->tooltipfont==NULL && strcmp(rcfile->section[i]->key[j]->key, "tooltip_font") == 0) {
-					l=strlen(rcfile->section[i]->key[j]->value)+1;
-					options->tooltipfont=(char *)malloc(sizeof(char)*l);
-					strncpy(options->tooltipfont, rcfile->section[i]->key[j]->value, l);
-				}
-#endif
+	/* look up the options of the wmappl section */
+	for(id = 0; id < RC_KEY_COUNT; id++) {
+		value = rc_get(rcfile, "wmappl", rc_key_name(id));
+		if(value!=NULL)
+			rc_option(id, value);
+	}
+
+	return rcfile;
+}
+
+/* create a button, in lazy mode its icon is loaded later */
+XpmButton *create_button(char *iconname) {
+	if(options->lazy)
+		return create_lazy_xpmbutton(iconname);
+	return create_xpmbutton(iconname, dockapp_get_display());
+}
+
+#if !HAVE_IMLIB2
+void preload_icons(RCFile *rcfile, int limit) {
+	int i, j, count = 0;
+	char **names;
+
+	names = (char **) malloc(sizeof(char *) * (rcfile->section_count + 1));
+	if(!names)
+		return;
+
+	/* resolve the icon of every section, missing ones are reported later */
+	for(i = 0; i < rcfile->section_count && count < limit; i++) {
+		if(strcmp(rcfile->section[i]->section_name, "wmappl") == 0)
+			continue;
+
+		for(j = 0; j < rcfile->section[i]->key_count; j++) {
+			if(rcfile->section[i]->key[j]->id == RC_KEY_ICON) {
+				names[count] = get_abspath_to_icon(rcfile->section[i]->key[j]->value);
+				if(names[count])
+					count++;
+				break;
 			}
 		}
 	}
-	return rcfile;
+
+	/* decode them all at once, on as many threads as there are cpus */
+	preload_icon_images(dockapp_get_display(), names, count);
+
+	for(i = 0; i < count; i++)
+		free(names[i]);
+	free(names);
 }
+#endif
 
-void load_icons(RCFile *rcfile, IconPath *iconpath) {
+void load_icons(RCFile *rcfile) {
 	int i, j;
 	XpmButton *first = NULL;
 	char *iconname = NULL, *command = NULL;
@@ -535,6 +707,12 @@ void load_icons(RCFile *rcfile, IconPath *iconpath) {
 	set_xpmbutton_position(sleft, scroll_positions[0], scroll_positions[1]);
 	set_xpmbutton_position(sright, scroll_positions[2], scroll_positions[3]);
 
+#if !HAVE_IMLIB2
+	/* decode the icons in parallel before they are uploaded one by one,
+	 * in lazy mode only the first two pages are loaded right away */
+	preload_icons(rcfile, options->lazy ? 12 : rcfile->section_count);
+#endif
+
 	/* traverse the structure, loading each icon */
 	for(i = 0; i < rcfile->section_count; i++) {
 
@@ -552,28 +730,31 @@ void load_icons(RCFile *rcfile, IconPath *iconpath) {
 #endif
 
 		for(j = 0; j < rcfile->section[i]->key_count; j++) {
-			if(strcmp(rcfile->section[i]->key[j]->key, "icon") == 0) {
-				iconname = get_abspath_to_icon(rcfile->section[i]->key[j]->value, iconpath);
-				if(!iconname) {
-					fprintf(stderr, "wmappl.c: Couldn't find %s in the iconpath.\n", rcfile->section[i]->key[j]->value);
-					exit(1);
-				}
-			}
-			if(strcmp(rcfile->section[i]->key[j]->key, "command") == 0) {
-				command = rcfile->section[i]->key[j]->value;
-			}
-
+			switch(rcfile->section[i]->key[j]->id) {
+				case RC_KEY_ICON:
+					iconname = get_abspath_to_icon(rcfile->section[i]->key[j]->value);
+					if(!iconname) {
+						fprintf(stderr, "wmappl.c: Couldn't find %s in the iconpath.\n", rcfile->section[i]->key[j]->value);
+						exit(1);
+					}
+					break;
+				case RC_KEY_COMMAND:
+					command = rcfile->section[i]->key[j]->value;
+					break;
 #ifdef USE_TOOLTIPS
-			if(strcmp(rcfile->section[i]->key[j]->key, "tooltip") == 0) {
-				tooltip = rcfile->section[i]->key[j]->value;
-			}
+				case RC_KEY_TOOLTIP:
+					tooltip = rcfile->section[i]->key[j]->value;
+					break;
 #endif
+				default:
+					break;
+			}
 		}
 
 		if(iconname && command) {
 			if(!first) {
 				/* create the xpmbutton */
-				first = create_xpmbutton(iconname, dockapp_get_display());
+				first = create_button(iconname);
 				if(!first) {
 					fprintf(stderr, "wmappl.c: Couldn't load icon %s.\n", iconname);
 					exit(1);
@@ -598,7 +779,7 @@ void load_icons(RCFile *rcfile, IconPath *iconpath) {
 			}
 			else {
 				/* create the xpmbutton */
-				icons->next = create_xpmbutton(iconname, dockapp_get_display());
+				icons->next = create_button(iconname);
 				if(!icons->next) {
 					fprintf(stderr, "wmappl.c: Couldn't load icon %s.\n", iconname);
 					exit(1);
@@ -647,7 +828,6 @@ void load_icons(RCFile *rcfile, IconPath *iconpath) {
 int main(int argc, char **argv) {
 	char *fn;
 	RCFile *rcfile=NULL;
-	IconPath *iconpath=NULL;;
 
 	/* create options structure */
 	options = opt_create_options();
@@ -670,6 +850,11 @@ int main(int argc, char **argv) {
 	/* handle any unset parameters */
 	if(options->withdrawn<0) options->withdrawn=1;
 	if(options->debugmode<0) options->debugmode=0;
+	if(options->prefork<0) options->prefork=0;
+	if(options->pixmap_cache_kb<0) options->pixmap_cache_kb=0;
+	/* loading every icon only to evict most of them again is pointless */
+	if(options->pixmap_cache_kb>0) options->lazy=1;
+	if(options->lazy<0) options->lazy=0;
 	if(options->name==NULL) {
 		options->name=(char *)malloc(sizeof(char)*(strlen(PACKAGE)+1));
 		strcpy(options->name, PACKAGE);
@@ -679,19 +864,38 @@ int main(int argc, char **argv) {
 		strcpy(options->colonpath, ICONPATH);
 	}
 
+	/* start the launcher helper while this process is still small */
+	if(options->prefork && !options->debugmode) {
+		launcher_start_helper();
+	}
+
 	/* init display */
 	if (dockapp_init_display() < 0) {
 	  exit(1);
 	}
 
-	/* parse the icon path */
-	iconpath = opt_create_iconpath(options->colonpath);
+	/* icons resolved at an earlier start are reused while the icon path
+	 * is unchanged, it is only indexed once one of them isn't */
+	rccache_check_iconpath(options->colonpath);
+
+	/* buttons keep their rendered cells while they scroll through here */
+	set_xpmbutton_area(BUTTON_AREA_X, BUTTON_AREA_Y, COLUMNS * COLUMN_WIDTH, COLUMN_HEIGHT);
+
+	/* limit the server memory used by icons */
+	set_xpmbutton_budget((unsigned long) options->pixmap_cache_kb * 1024);
 
 	/* load the icons */
-	load_icons(rcfile, iconpath);
+	load_icons(rcfile);
 
-	/* free the RCFile structure */
-	free_rcfile(rcfile);
+	/* remember the decoded icons for the next start, in lazy mode once
+	 * the remaining icons have been loaded while idle */
+	if(options->lazy) {
+		idle_button = icons;
+		dockapp_set_idle(wmappl_idle);
+	}
+	else {
+		iconcache_save();
+	}
 
 	/* create the dockapp */
 	if(!dockapp_create(options->name, "64x64+0+0", interface_xpm, options->withdrawn, argc, argv)) {
@@ -701,7 +905,7 @@ int main(int argc, char **argv) {
 
 	/* set background icon */
 	if(options->bgicon!=NULL) {
-		fn = get_abspath_to_icon(options->bgicon, iconpath);
+		fn = get_abspath_to_icon(options->bgicon);
 		if(fn==NULL) {
 			fprintf(stderr, "Could not find background icon in iconpath: %s\n", options->bgicon);
 			exit(1);
@@ -713,8 +917,15 @@ int main(int argc, char **argv) {
 		dockapp_set_background_color(options->bgcolor);
 	}
 
+	/* remember the compiled rc file and the resolved icons */
+	rccache_save(rcfile);
+
+	/* free the RCFile structure */
+	free_rcfile(rcfile);
+
 	/* free the icon path */
 	opt_free_iconpath(iconpath);
+	iconpath = NULL;
 
 	/* set the paint and mouse callbacks */
 	dockapp_set_paint(wmappl_paint);
@@ -731,6 +942,9 @@ int main(int argc, char **argv) {
 	}
 #endif
 
+	/* reap launched commands from the event loop */
+	dockapp_add_input(launcher_init(), launcher_reap);
+
 	/* enter the dockapp event loop */
 	dockapp_run();
 
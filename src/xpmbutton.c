@@ -22,6 +22,367 @@
 
 #include "xpmbutton.h"
 #include "pixmap.h"
+#include "launcher.h"
+#include "dockapp.h"
+
+/* width of the atlas pixmap, buttons are packed into rows (shelves)
+ * of this width, the atlas grows downwards as buttons are added */
+#define ATLAS_WIDTH	576
+
+Pixmap atlas = None;
+int atlas_height = 0;	/* allocated height of atlas */
+int shelf_x = 0, shelf_y = 0, shelf_height = 0;
+
+/* area the buttons are moved around in, see set_xpmbutton_area */
+int area_x = 0, area_y = 0, area_width = 0, area_height = 0;
+
+/* cells given back by evicted buttons, reused by buttons of the same size */
+typedef struct {
+	int x, y, width, height;
+} AtlasCell;
+
+AtlasCell *free_cells = NULL;
+int free_cell_count = 0, free_cell_alloc = 0;
+
+/* loaded buttons with an icon file, most recently drawn first and the
+ * ones loaded but not drawn yet at the end */
+XpmButton *lru_first = NULL, *lru_last = NULL;
+int lru_count = 0;
+unsigned long pixmap_budget = 0;	/* bytes, 0 for no limit */
+unsigned long cell_memory = 0;	/* bytes of atlas cells held by loaded buttons */
+
+/* icons never evicted: the visible page and a page to either side */
+#define MIN_RESIDENT	18
+
+/* allocate_xpmbutton_cells
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : XpmButton to reserve atlas cells for
+ *	NOTE:
+ *		Only reserves the space, the atlas pixmap is (re)allocated
+ *		when the button is first drawn.
+ */
+static void allocate_xpmbutton_cells(XpmButton *xpmbutton)
+{
+	int i;
+
+	/* nothing has been rendered yet */
+	for(i = 0; i < 2; i++) {
+		xpmbutton->cell_x[i] = -1;
+		xpmbutton->cell_y[i] = -1;
+	}
+
+	/* reuse a cell of an evicted button if one fits exactly */
+	for(i = 0; i < free_cell_count; i++) {
+		if(free_cells[i].width == xpmbutton->width && free_cells[i].height == xpmbutton->height) {
+			xpmbutton->atlas_x = free_cells[i].x;
+			xpmbutton->atlas_y = free_cells[i].y;
+			free_cells[i] = free_cells[--free_cell_count];
+			return;
+		}
+	}
+
+	if(shelf_x + 2 * xpmbutton->width > ATLAS_WIDTH) {
+		shelf_y += shelf_height;
+		shelf_x = 0;
+		shelf_height = 0;
+	}
+
+	xpmbutton->atlas_x = shelf_x;
+	xpmbutton->atlas_y = shelf_y;
+
+	shelf_x += 2 * xpmbutton->width;
+	if(xpmbutton->height > shelf_height)
+		shelf_height = xpmbutton->height;
+}
+
+/* release_xpmbutton_cells
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : XpmButton to take the atlas cells from
+ */
+static void release_xpmbutton_cells(XpmButton *xpmbutton)
+{
+	AtlasCell *grown;
+
+	if(free_cell_count == free_cell_alloc) {
+		free_cell_alloc = free_cell_alloc ? free_cell_alloc * 2 : 16;
+		grown = (AtlasCell *) realloc(free_cells, free_cell_alloc * sizeof(AtlasCell));
+		if(!grown) {
+			/* the cells are simply lost */
+			free_cell_alloc = free_cell_count;
+			return;
+		}
+		free_cells = grown;
+	}
+
+	free_cells[free_cell_count].x = xpmbutton->atlas_x;
+	free_cells[free_cell_count].y = xpmbutton->atlas_y;
+	free_cells[free_cell_count].width = xpmbutton->width;
+	free_cells[free_cell_count].height = xpmbutton->height;
+	free_cell_count++;
+}
+
+/* lru_unlink - takes a button off the list of loaded buttons */
+static void lru_unlink(XpmButton *xpmbutton)
+{
+	if(xpmbutton->lru_prev)
+		xpmbutton->lru_prev->lru_next = xpmbutton->lru_next;
+	else
+		lru_first = xpmbutton->lru_next;
+	if(xpmbutton->lru_next)
+		xpmbutton->lru_next->lru_prev = xpmbutton->lru_prev;
+	else
+		lru_last = xpmbutton->lru_prev;
+
+	xpmbutton->lru_prev = NULL;
+	xpmbutton->lru_next = NULL;
+	lru_count--;
+}
+
+/* lru_push - puts a button at the front of the list of loaded buttons */
+static void lru_push(XpmButton *xpmbutton)
+{
+	xpmbutton->lru_prev = NULL;
+	xpmbutton->lru_next = lru_first;
+	if(lru_first)
+		lru_first->lru_prev = xpmbutton;
+	else
+		lru_last = xpmbutton;
+	lru_first = xpmbutton;
+	lru_count++;
+}
+
+/* lru_append - puts a button at the end of the list of loaded buttons */
+static void lru_append(XpmButton *xpmbutton)
+{
+	xpmbutton->lru_next = NULL;
+	xpmbutton->lru_prev = lru_last;
+	if(lru_last)
+		lru_last->lru_next = xpmbutton;
+	else
+		lru_first = xpmbutton;
+	lru_last = xpmbutton;
+	lru_count++;
+}
+
+/* cell_bytes - estimated server memory of the two atlas cells of a button */
+static unsigned long cell_bytes(XpmButton *xpmbutton,
+								Display * display)
+{
+	int depth = DefaultDepth(display, DefaultScreen(display));
+
+	return 2UL * xpmbutton->width * xpmbutton->height * (depth > 16 ? 4 : depth > 8 ? 2 : 1);
+}
+
+/* budget_memory - server memory counted against the budget, the icons
+ * and the rendered cells of the loaded buttons */
+static unsigned long budget_memory(void)
+{
+	return icon_image_memory() + cell_memory;
+}
+
+/* evict_xpmbutton
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : loaded XpmButton to free the icon of
+ *		Display *display     : X11 display
+ *	NOTE:
+ *		The button goes back to the state of a lazily created one and
+ *		is loaded again when it is drawn.
+ */
+static void evict_xpmbutton(XpmButton *xpmbutton,
+							Display * display)
+{
+	lru_unlink(xpmbutton);
+
+	if(xpmbutton->image)
+		release_icon_image(display, xpmbutton->image);
+	xpmbutton->image = NULL;
+	xpmbutton->pixmap = None;
+	xpmbutton->pixmask = None;
+
+	release_xpmbutton_cells(xpmbutton);
+	cell_memory -= cell_bytes(xpmbutton, display);
+	xpmbutton->loaded = 0;
+}
+
+/* enforce_budget
+ *	PARAMETERS:
+ *		Display *display : X11 display
+ *		XpmButton *keep  : button that was just loaded
+ *	NOTE:
+ *		Evicts from the end of the list, buttons that were loaded ahead
+ *		of time and never drawn go before the ones on screen.
+ */
+static void enforce_budget(Display * display,
+						   XpmButton *keep)
+{
+	XpmButton      *victim, *prev;
+
+	if(!pixmap_budget)
+		return;
+
+	victim = lru_last;
+	while(victim && budget_memory() > pixmap_budget && lru_count > MIN_RESIDENT) {
+		prev = victim->lru_prev;
+		if(victim != keep)
+			evict_xpmbutton(victim, display);
+		victim = prev;
+	}
+}
+
+/* set_xpmbutton_area
+ *	PARAMETERS:
+ *		int x, y          : position of the area in the draw window
+ *		int width, height : size of the area
+ */
+void set_xpmbutton_area(int x,
+						int y,
+						int width,
+						int height)
+{
+	area_x = x;
+	area_y = y;
+	area_width = width;
+	area_height = height;
+}
+
+/* in_uniform_area - nonzero if a button at x, y lies in the area and the
+ * background is the same everywhere in it */
+static int in_uniform_area(XpmButton *xpmbutton,
+						   int x,
+						   int y)
+{
+	if(x < area_x || y < area_y || x + xpmbutton->width > area_x + area_width ||
+	   y + xpmbutton->height > area_y + area_height)
+		return 0;
+
+	return dockapp_background_uniform(area_x, area_y, area_width, area_height);
+}
+
+/* cell_is_current - nonzero if the cell of state can be shown at the
+ * button's position as it is */
+static int cell_is_current(XpmButton *xpmbutton,
+						   int state)
+{
+	if(xpmbutton->cell_serial[state] != dockapp_background_serial())
+		return 0;
+	if(xpmbutton->cell_x[state] == xpmbutton->x && xpmbutton->cell_y[state] == xpmbutton->y)
+		return 1;
+
+	/* the background doesn't change under a button moved within the area */
+	return in_uniform_area(xpmbutton, xpmbutton->cell_x[state], xpmbutton->cell_y[state]) &&
+	       in_uniform_area(xpmbutton, xpmbutton->x, xpmbutton->y);
+}
+
+/* set_xpmbutton_budget
+ *	PARAMETERS:
+ *		unsigned long bytes : server memory the icons may use, 0 for no limit
+ */
+void set_xpmbutton_budget(unsigned long bytes)
+{
+	pixmap_budget = bytes;
+}
+
+/* xpmbutton_budget_full
+ *	RETURN:
+ *		int : nonzero if loading another icon would exceed the budget
+ */
+int xpmbutton_budget_full()
+{
+	return pixmap_budget && budget_memory() >= pixmap_budget;
+}
+
+/* grow_atlas
+ *	PARAMETERS:
+ *		Display *display : X11 display
+ *	RETURN:
+ *		int : non-zero if the atlas holds every allocated cell
+ */
+static int grow_atlas(Display *display)
+{
+	Pixmap grown;
+	GC copygc;
+	int height = shelf_y + shelf_height;
+
+	if(atlas != None && height <= atlas_height)
+		return 1;
+
+	grown = XCreatePixmap(display, RootWindow(display, DefaultScreen(display)),
+	                      ATLAS_WIDTH, height, DefaultDepth(display, DefaultScreen(display)));
+	if(grown == None) {
+		fprintf(stderr, "xpmbutton.c (error) : Couldn't allocate atlas pixmap.\n");
+		return 0;
+	}
+
+	/* keep the cells rendered so far */
+	if(atlas != None) {
+		copygc = XCreateGC(display, grown, 0, NULL);
+		XCopyArea(display, atlas, grown, copygc, 0, 0, ATLAS_WIDTH, atlas_height, 0, 0);
+		XFreeGC(display, copygc);
+		XFreePixmap(display, atlas);
+	}
+
+	atlas = grown;
+	atlas_height = height;
+	return 1;
+}
+
+/* render_xpmbutton_cell
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : XpmButton to render
+ *		Display *display     : X11 display
+ *		GC gc                : graphics context to use for drawing
+ *		int state            : 0 for released, 1 for pressed
+ */
+static void render_xpmbutton_cell(XpmButton *xpmbutton,
+								  Display * display,
+								  GC gc,
+								  int state)
+{
+	Pixel           bl, wh;
+	int             x, y, w, h;
+
+	bl = BlackPixel(display, DefaultScreen(display));
+	wh = WhitePixel(display, DefaultScreen(display));
+
+	x = xpmbutton->atlas_x + state * xpmbutton->width;
+	y = xpmbutton->atlas_y;
+	w = xpmbutton->width;
+	h = xpmbutton->height;
+
+	/* start with the background found at the button's position */
+	dockapp_draw_background(atlas, x, y, w, h, xpmbutton->x, xpmbutton->y);
+
+	if(state)
+		XSetForeground(display, gc, bl);
+	else
+		XSetForeground(display, gc, wh);
+
+	XDrawLine(display, atlas, gc, x, y, x + (w - 1), y);
+	XDrawLine(display, atlas, gc, x, y, x, y + (h - 2));
+
+	if(state)
+		XSetForeground(display, gc, wh);
+	else
+		XSetForeground(display, gc, bl);
+
+	XDrawLine(display, atlas, gc, x, y + (h - 1), x + (w - 1), y + (h - 1));
+	XDrawLine(display, atlas, gc, x + (w - 1), y + 1, x + (w - 1), y + (h - 1));
+
+	if(xpmbutton->pixmap != None) {
+		/* set clipping mask to allow transparency */
+		XSetClipOrigin(display, gc, x+1, y+1);
+		XSetClipMask(display, gc, xpmbutton->pixmask);
+
+		XCopyArea(display, xpmbutton->pixmap, atlas, gc, 0, 0, w - 2, h - 2, x + 1, y + 1);
+
+		/* clear clipping mask */
+		XSetClipMask(display, gc, None);
+	}
+
+	xpmbutton->cell_x[state] = xpmbutton->x;
+	xpmbutton->cell_y[state] = xpmbutton->y;
+	xpmbutton->cell_serial[state] = dockapp_background_serial();
+}
 
 /* create_xpmbutton
  *	PARAMETERS:
@@ -34,29 +395,58 @@ XpmButton      *create_xpmbutton(char *filename,
 								 Display * display)
 {
 	XpmButton      *xpmbutton;
-	XpmAttributes   xpmattributes;
 
-	xpmattributes.valuemask = 0;
-	xpmbutton = (XpmButton *) malloc(sizeof(XpmButton));
-	memset(xpmbutton,0,sizeof(xpmbutton));
+	xpmbutton = create_lazy_xpmbutton(filename);
+	if(!xpmbutton)
+		return NULL;
+
+	if(load_xpmbutton(xpmbutton, display) < 0) {
+		free_xpmbutton(xpmbutton, display);
+		return NULL;
+	}
+
+	return xpmbutton;
+}
+
+/* create_lazy_xpmbutton
+ *	PARAMETERS:
+ *      char *filename : xpm filename to load later
+ *	RETURN:
+ *		XpmButton* : an XpmButton structure
+ */
+XpmButton      *create_lazy_xpmbutton(char *filename)
+{
+	XpmButton      *xpmbutton;
+
 	/* allocate an XpmButton structure */
+	xpmbutton = (XpmButton *) malloc(sizeof(XpmButton));
 	if(!xpmbutton) {
 		fprintf(stderr, "xpmbutton.c (warning): Couldn't allocate space for a new XpmButton.\n");
 		return NULL;
 	}
+	memset(xpmbutton, 0, sizeof(XpmButton));
 
-	if ( create_button_pixmap (display,filename,
-				   &xpmbutton->pixmap, &xpmbutton->pixmask, &xpmattributes) < 0 ) {
-	        return NULL;
+	xpmbutton->filename = (char *) malloc(strlen(filename) + 1);
+	if(!xpmbutton->filename) {
+		fprintf(stderr, "xpmbutton.c (warning): Couldn't allocate space for a new XpmButton.\n");
+		free(xpmbutton);
+		return NULL;
 	}
+	strcpy(xpmbutton->filename, filename);
 
-	/* set the XpmButton defaults */
+	/* set the XpmButton defaults, assume a 16x16 icon until it is loaded */
+	xpmbutton->pixmap = None;
+	xpmbutton->pixmask = None;
+	xpmbutton->image = NULL;
+	xpmbutton->loaded = 0;
 	xpmbutton->x = 0;
 	xpmbutton->y = 0;
-	xpmbutton->width = xpmattributes.width + 2;
-	xpmbutton->height = xpmattributes.height + 2;
+	xpmbutton->width = 16 + 2;
+	xpmbutton->height = 16 + 2;
 	xpmbutton->pressed = 0;
+	xpmbutton->dirty = 1;
 	xpmbutton->command = NULL;
+	xpmbutton->argv = NULL;
 	xpmbutton->tooltip = NULL;
 	xpmbutton->last = NULL;
 	xpmbutton->next = NULL;
@@ -64,6 +454,47 @@ XpmButton      *create_xpmbutton(char *filename,
 	return xpmbutton;
 }
 
+/* load_xpmbutton
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : XpmButton to load the icon of
+ *		Display *display     : X11 display
+ *	RETURN:
+ *		int : 0 on success or if already loaded, <0 on error
+ */
+int load_xpmbutton(XpmButton *xpmbutton,
+				   Display * display)
+{
+	if(!xpmbutton || xpmbutton->loaded)
+		return 0;
+
+	/* buttons showing the same icon share one decoded image */
+	xpmbutton->image = acquire_icon_image(display, xpmbutton->filename);
+
+	/* don't try again, the button is drawn without an icon */
+	xpmbutton->loaded = 1;
+
+	if(xpmbutton->image) {
+		xpmbutton->pixmap = xpmbutton->image->pixmap;
+		xpmbutton->pixmask = xpmbutton->image->pixmask;
+		xpmbutton->width = xpmbutton->image->width + 2;
+		xpmbutton->height = xpmbutton->image->height + 2;
+	}
+
+	allocate_xpmbutton_cells(xpmbutton);
+	xpmbutton->dirty = 1;
+
+	if(!xpmbutton->image)
+		return -1;
+
+	/* make room for it within the budget, it only moves to the front
+	 * of the list once it is drawn */
+	cell_memory += cell_bytes(xpmbutton, display);
+	lru_append(xpmbutton);
+	enforce_budget(display, xpmbutton);
+
+	return 0;
+}
+
 /* create_include_xpmbutton
  *	PARAMETERS:
  *      static char **data : xpm character array to load
@@ -84,6 +515,7 @@ XpmButton      *create_include_xpmbutton(char **data,
 		fprintf(stderr, "xpmbutton.c (warning): Couldn't allocate space for a new XpmButton.\n");
 		return NULL;
 	}
+	memset(xpmbutton, 0, sizeof(XpmButton));
 	/* load the xpm data */
 	if(XpmCreatePixmapFromData(display,
 							   RootWindow(display, DefaultScreen(display)),
@@ -92,22 +524,66 @@ XpmButton      *create_include_xpmbutton(char **data,
 		return NULL;
 	}
 	/* set the XpmButton defaults */
+	xpmbutton->image = NULL;
+	xpmbutton->filename = NULL;
+	xpmbutton->loaded = 1;
 	xpmbutton->width = xpmattributes.width + 2;
 	xpmbutton->height = xpmattributes.height + 2;
 	xpmbutton->pressed = 0;
+	xpmbutton->dirty = 1;
 	xpmbutton->command = NULL;
+	xpmbutton->argv = NULL;
 	xpmbutton->tooltip = NULL;
 	xpmbutton->last = NULL;
 	xpmbutton->next = NULL;
 
+	allocate_xpmbutton_cells(xpmbutton);
+
 	return xpmbutton;
 }
 
+/* free_xpmbutton
+ *	PARAMETERS:
+ *		XpmButton *xpmbutton : XpmButton to free
+ *		Display *display     : X11 display
+ *	RETURN:
+ *		none
+ */
+void free_xpmbutton(XpmButton *xpmbutton,
+					Display * display)
+{
+	if(!xpmbutton)
+		return;
+
+	if(xpmbutton->image) {
+		lru_unlink(xpmbutton);
+		release_icon_image(display, xpmbutton->image);
+		cell_memory -= cell_bytes(xpmbutton, display);
+	}
+	else if(xpmbutton->pixmap != None) {
+		XFreePixmap(display, xpmbutton->pixmap);
+		if(xpmbutton->pixmask != None)
+			XFreePixmap(display, xpmbutton->pixmask);
+	}
+
+	if(xpmbutton->filename)
+		free(xpmbutton->filename);
+	if(xpmbutton->command)
+		free(xpmbutton->command);
+	if(xpmbutton->argv)
+		free(xpmbutton->argv);
+	if(xpmbutton->tooltip)
+		free(xpmbutton->tooltip);
+	free(xpmbutton);
+}
 
 /* set_xpmbutton_command
  *	PARAMETERS:
  *      XpmButton *xpmbutton : XpmButton to set command for
  *		char *command        : command to set in xpmbutton
+ *	NOTE:
+ *		The command is also split into an argument vector here, so
+ *		that plain commands can be executed without /bin/sh.
  *	RETURN:
  *		none
  */
@@ -119,10 +595,12 @@ void set_xpmbutton_command(XpmButton *xpmbutton,
 
 	if(command==NULL) {
 		xpmbutton->command = NULL;
+		xpmbutton->argv = NULL;
 	}
 	else {
 		xpmbutton->command = (char *) malloc(strlen(command)+1);
 		strncpy(xpmbutton->command, command, strlen(command)+1);
+		xpmbutton->argv = launcher_parse_command(command);
 	}
 }
 
@@ -183,6 +661,8 @@ void set_xpmbutton_next(XpmButton *xpmbutton,
  *		XpmButton *xpmbutton : XpmButton to set position for
  * 		int x  : x coordinate of xpmbutton     
  *		int y  : y coordinate of xpmbutton
+ *	NOTE:
+ *		Marks the button dirty if it moved.
  *	RETURN:
  *		none
  */
@@ -192,6 +672,8 @@ void set_xpmbutton_position(XpmButton *xpmbutton,
 {
 	if(!xpmbutton)
 		return;
+	if(xpmbutton->x != x || xpmbutton->y != y)
+		xpmbutton->dirty = 1;
 	xpmbutton->x = x;
 	xpmbutton->y = y;
 }
@@ -201,6 +683,8 @@ void set_xpmbutton_position(XpmButton *xpmbutton,
  *      XpmButton *xpmbutton : XpmButton to set state for
  *      int pressed  : set to nonzero if button should be
  *                     drawn pressed
+ *  NOTE:
+ *      Marks the button dirty if its state changed.
  *  RETURN:
  *      none
  */
@@ -209,6 +693,8 @@ void set_xpmbutton_pressed(XpmButton *xpmbutton,
 {
 	if(!xpmbutton)
 		return;
+	if((xpmbutton->pressed != 0) != (pressed != 0))
+		xpmbutton->dirty = 1;
 	xpmbutton->pressed = pressed;
 }
 
@@ -241,6 +727,14 @@ int is_xpmbutton_at(XpmButton *xpmbutton,
  *		Display *display     : display to draw on
  *		Drawable drawable    : drawable to draw into
  *		GC gc                : graphics context to use for drawing
+ *	NOTE:
+ *		Each button is rendered, bevel and icon composited over the
+ *		background, into a cell of a shared atlas pixmap the first time
+ *		it is drawn in a state. Drawing it again is then a single
+ *		XCopyArea from the atlas. A button that moved is only rendered
+ *		again if the background differs under its new position, so
+ *		over a plain button area scrolling renders nothing. Clears the
+ *		dirty flag.
  *	RETURN:
  *		none
  */
@@ -249,42 +743,31 @@ void draw_xpmbutton(XpmButton *xpmbutton,
 					Drawable drawable,
 					GC gc)
 {
-	Pixel           bl, wh;
-	int             x, y, w, h;
+	int             state;
 
 	if(!xpmbutton)
 		return;
 
-	bl = BlackPixel(display, DefaultScreen(display));
-	wh = WhitePixel(display, DefaultScreen(display));
-
-	x = xpmbutton->x;
-	y = xpmbutton->y;
-	w = xpmbutton->width;
-	h = xpmbutton->height;
-
-	if(xpmbutton->pressed)
-		XSetForeground(display, gc, bl);
-	else
-		XSetForeground(display, gc, wh);
-
-	XDrawLine(display, drawable, gc, x, y, x + (w - 1), y);
-	XDrawLine(display, drawable, gc, x, y, x, y + (h - 2));
+	/* a lazily created or evicted button is loaded once it is shown */
+	if(!xpmbutton->loaded)
+		load_xpmbutton(xpmbutton, display);
+	if(xpmbutton->image && xpmbutton != lru_first) {
+		lru_unlink(xpmbutton);
+		lru_push(xpmbutton);
+	}
 
-	if(xpmbutton->pressed)
-		XSetForeground(display, gc, wh);
-	else
-		XSetForeground(display, gc, bl);
+	if(!grow_atlas(display))
+		return;
 
-	XDrawLine(display, drawable, gc, x, y + (h - 1), x + (w - 1), y + (h - 1));
-	XDrawLine(display, drawable, gc, x + (w - 1), y + 1, x + (w - 1), y + (h - 1));
+	state = xpmbutton->pressed ? 1 : 0;
 
-	/* set clipping mask to allow transparency */
-	XSetClipOrigin(display, gc, x+1, y+1);
-	XSetClipMask(display, gc, xpmbutton->pixmask);
+	/* re-render the cell if it is stale */
+	if(!cell_is_current(xpmbutton, state))
+		render_xpmbutton_cell(xpmbutton, display, gc, state);
 
-	XCopyArea(display, xpmbutton->pixmap, drawable, gc, 0, 0, w - 2, h - 2, x + 1, y + 1);
+	XCopyArea(display, atlas, drawable, gc,
+			  xpmbutton->atlas_x + state * xpmbutton->width, xpmbutton->atlas_y,
+			  xpmbutton->width, xpmbutton->height, xpmbutton->x, xpmbutton->y);
 
-	/* clear clipping mask */
-	XSetClipMask(display, gc, None);
+	xpmbutton->dirty = 0;
 }
@@ -28,16 +28,27 @@
 #include <X11/xpm.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include "pixmap.h"
 
 typedef struct _XpmButton_ {
 	Pixmap pixmap;
 	Pixmap pixmask;
+	IconImage *image;	/* shared image the pixmaps belong to, NULL if owned */
+	char *filename;	/* icon file, NULL for built in icons */
+	int loaded;	/* icon has been loaded (or failed to load) */
 	int pressed;
+	int dirty;	/* needs to be drawn again */
 	char *command;
+	char **argv;	/* pre-parsed command, NULL if it needs /bin/sh */
 	char *tooltip;
 	int x, y, width, height;
+	int atlas_x, atlas_y;	/* released state cell, the pressed one is right of it */
+	int cell_x[2], cell_y[2];	/* position each cell was composited for */
+	unsigned long cell_serial[2];	/* background each cell was composited over */
 	struct _XpmButton_ *last;
 	struct _XpmButton_ *next;
+	struct _XpmButton_ *lru_prev;	/* loaded buttons, most recently drawn first, undrawn last */
+	struct _XpmButton_ *lru_next;
 } XpmButton;
 
 /* create_xpmbutton
@@ -50,6 +61,82 @@ typedef struct _XpmButton_ {
 XpmButton*
 create_xpmbutton(char *filename, Display *display);
 
+/* create_lazy_xpmbutton
+ *  PARAMETERS:
+ *      char *filename : xpm filename to load later
+ *  NOTE:
+ *      Only the filename is kept, the icon is loaded by load_xpmbutton
+ *      or at the latest when the button is first drawn.
+ *  RETURN:
+ *      XpmButton* : an XpmButton structure
+ */
+XpmButton*
+create_lazy_xpmbutton(char *filename);
+
+/* load_xpmbutton
+ *  PARAMETERS:
+ *      XpmButton *xpmbutton : XpmButton to load the icon of
+ *      Display *display     : X11 display
+ *  NOTE:
+ *      Does nothing if the icon is loaded already. If it can't be
+ *      loaded the button is drawn without an icon. A button loaded
+ *      ahead of time is the first to be evicted until it is drawn.
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int
+load_xpmbutton(XpmButton *xpmbutton, Display *display);
+
+/* set_xpmbutton_area
+ *  PARAMETERS:
+ *      int x, y          : position of the area in the draw window
+ *      int width, height : size of the area
+ *  NOTE:
+ *      The area the buttons scroll through. While the background is a
+ *      single color in it, a button rendered anywhere in it is reused
+ *      at any other position in it.
+ *  RETURN:
+ *      none
+ */
+void
+set_xpmbutton_area(int x, int y, int width, int height);
+
+/* set_xpmbutton_budget
+ *  PARAMETERS:
+ *      unsigned long bytes : server memory the icons may use, 0 for no limit
+ *  NOTE:
+ *      The budget covers the icons and the two atlas cells rendered
+ *      for each loaded button. When loading an icon pushes the total
+ *      over the budget, the buttons drawn least recently are unloaded
+ *      again. They are reloaded when the button is drawn the next
+ *      time. The 18 most recently drawn buttons, the visible page and
+ *      a page to either side, are always kept, even over the budget.
+ *  RETURN:
+ *      none
+ */
+void
+set_xpmbutton_budget(unsigned long bytes);
+
+/* xpmbutton_budget_full
+ *  RETURN:
+ *      int : nonzero if loading another icon would exceed the budget
+ */
+int
+xpmbutton_budget_full(void);
+
+/* free_xpmbutton
+ *  PARAMETERS:
+ *      XpmButton *xpmbutton : XpmButton to free
+ *      Display *display     : X11 display
+ *  NOTE:
+ *      Releases the button's reference to its icon image, the pixmaps
+ *      are only freed once no other button shows the same icon.
+ *  RETURN:
+ *      none
+ */
+void
+free_xpmbutton(XpmButton *xpmbutton, Display *display);
+
 /* create_include_xpmbutton
  *  PARAMETERS:
  *      char **data : xpm character array to load
@@ -64,6 +151,9 @@ create_include_xpmbutton(char **data, Display *display);
  *  PARAMETERS:
  *      XpmButton *xpmbutton : XpmButton to set command for
  *      char *command        : command to set in xpmbutton
+ *  NOTE:
+ *      The command is also split into an argument vector here, so
+ *      that plain commands can be executed without /bin/sh.
  *  RETURN:
  *      none
  */
@@ -105,6 +195,8 @@ set_xpmbutton_next(XpmButton *xpmbutton, XpmButton *next);
  *		XpmButton *xpmbutton : XpmButton to set position for
  *      int x  : x coordinate of xpmbutton
  *      int y  : y coordinate of xpmbutton
+ *  NOTE:
+ *      Marks the button dirty if it moved.
  *  RETURN:
  *      none
  */
@@ -116,6 +208,8 @@ set_xpmbutton_position(XpmButton *xpmbutton, int x, int y);
  *		XpmButton *xpmbutton : XpmButton to set state for
  *      int pressed  : set to nonzero if button should be
  *                     drawn pressed
+ *  NOTE:
+ *      Marks the button dirty if its state changed.
  *  RETURN:
  *      none
  */
@@ -140,6 +234,11 @@ is_xpmbutton_at(XpmButton *xpmbutton, int x, int y);
  *      Display *display     : display to draw on
  *      Drawable drawable : drawable to draw into
  *      GC gc             : graphics context to use for drawing
+ *  NOTE:
+ *      Each button is rendered, bevel and icon composited over the
+ *      background, into a cell of a shared atlas pixmap the first time
+ *      it is drawn in a state at a position. Drawing it again is then
+ *      a single XCopyArea from the atlas. Clears the dirty flag.
  *  RETURN:
  *      none
  */
@@ -0,0 +1,563 @@
+/* xpmread.c
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "xpmread.h"
+#include "dockapp.h"
+#include "scale.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <X11/Xutil.h>
+
+/* limits for what is accepted as an icon */
+#define MAX_FILE_SIZE	(16 * 1024 * 1024)
+#define MAX_PIXELS	(4096 * 4096)
+#define MAX_CPP		8
+
+static GC image_gc = None, mask_gc = None;
+
+/* xpm_strings - collects the quoted strings of a C style XPM file,
+ * terminating them in place */
+static char **xpm_strings(char *buf, int *count)
+{
+	char **strings = NULL, **grown, *p, *end;
+	int alloc = 0;
+
+	*count = 0;
+	for(p = buf; *p; p++) {
+		/* skip comments, they may contain quotes */
+		if(p[0] == '/' && p[1] == '*') {
+			if((end = strstr(p + 2, "*/")) == NULL)
+				break;
+			p = end + 1;
+			continue;
+		}
+		if(*p != '"')
+			continue;
+
+		for(end = ++p; *end && *end != '"'; end++) {
+			if(*end == '\\' && end[1])
+				end++;
+		}
+		if(!*end)
+			break;
+		*end = '\0';
+
+		if(*count == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			grown = (char **) realloc(strings, alloc * sizeof(char *));
+			if(!grown) {
+				free(strings);
+				return NULL;
+			}
+			strings = grown;
+		}
+		strings[(*count)++] = p;
+		p = end;
+	}
+
+	return strings;
+}
+
+/* key_rank - preference of a color key, color over grayscale over mono,
+ * 0 for symbolic names which can't be resolved, <0 if not a key */
+static int key_rank(const char *t, int len)
+{
+	if(len == 1 && t[0] == 'c')
+		return 4;
+	if(len == 1 && t[0] == 'g')
+		return 3;
+	if(len == 2 && t[0] == 'g' && t[1] == '4')
+		return 2;
+	if(len == 1 && t[0] == 'm')
+		return 1;
+	if(len == 1 && t[0] == 's')
+		return 0;
+	return -1;
+}
+
+/* xpm_color - picks the best color out of the keys of a color line,
+ * returns -1 on error */
+static int xpm_color(const char *spec, char **color)
+{
+	const char *t, *start = NULL, *end = NULL, *best_start = NULL, *best_end = NULL;
+	int len, rank = -1, best = 0;
+
+	for(t = spec; ; t += len) {
+		while(isspace((unsigned char) *t))
+			t++;
+		for(len = 0; t[len] && !isspace((unsigned char) t[len]); len++)
+			;
+
+		/* a key ends the value before it, the token after a key is
+		 * always part of its value */
+		if(len == 0 || (start != NULL && key_rank(t, len) >= 0)) {
+			if(start != NULL && rank > best) {
+				best = rank;
+				best_start = start;
+				best_end = end;
+			}
+			start = NULL;
+			rank = -1;
+			if(len == 0)
+				break;
+		}
+
+		if(rank < 0) {
+			rank = key_rank(t, len);
+			if(rank < 0)
+				return -1;
+		}
+		else {
+			if(start == NULL)
+				start = t;
+			end = t + len;
+		}
+	}
+
+	if(best_start == NULL)
+		return -1;
+
+	len = best_end - best_start;
+	if(len == 4 && strncasecmp(best_start, "None", 4) == 0) {
+		*color = NULL;
+		return 0;
+	}
+
+	*color = (char *) malloc(len + 1);
+	if(!*color)
+		return -1;
+	memcpy(*color, best_start, len);
+	(*color)[len] = '\0';
+
+	return 0;
+}
+
+/* xpm_hash - hash of the cpp characters naming a color */
+static unsigned int xpm_hash(const char *s, int cpp)
+{
+	unsigned int h = 5381;
+
+	while(cpp--)
+		h = h * 33 + (unsigned char) *s++;
+
+	return h;
+}
+
+/* xpm_parse - decodes the strings of an XPM image */
+static int xpm_parse(char **lines, int count, DecodedXpm *xpm)
+{
+	int w, h, ncolors, cpp, i, x, y, size = 0, *slot = NULL, index;
+	char *keys = NULL, *row;
+	unsigned int k;
+	int map[256];
+
+	memset(xpm, 0, sizeof(DecodedXpm));
+
+	if(count < 1 || sscanf(lines[0], "%d %d %d %d", &w, &h, &ncolors, &cpp) != 4)
+		return -1;
+	if(w <= 0 || h <= 0 || ncolors <= 0 || cpp <= 0 || cpp > MAX_CPP || w > MAX_PIXELS / h)
+		return -1;
+	if(count - 1 - ncolors < h)
+		return -1;
+
+	xpm->width = w;
+	xpm->height = h;
+	xpm->ncolors = ncolors;
+	xpm->color = (char **) calloc(ncolors, sizeof(char *));
+	xpm->data = (unsigned int *) malloc(sizeof(unsigned int) * w * h);
+	keys = (char *) malloc(ncolors * cpp);
+	if(!xpm->color || !xpm->data || !keys)
+		goto error;
+
+	/* colors, one character per pixel is looked up directly, longer
+	 * names through a small hash table */
+	if(cpp == 1) {
+		for(i = 0; i < 256; i++)
+			map[i] = -1;
+	}
+	else {
+		for(size = 16; size < 2 * ncolors; size *= 2)
+			;
+		slot = (int *) malloc(sizeof(int) * size);
+		if(!slot)
+			goto error;
+		for(i = 0; i < size; i++)
+			slot[i] = -1;
+	}
+
+	for(i = 0; i < ncolors; i++) {
+		row = lines[1 + i];
+		if((int) strnlen(row, cpp) < cpp || xpm_color(row + cpp, &xpm->color[i]) < 0)
+			goto error;
+		memcpy(keys + i * cpp, row, cpp);
+
+		if(cpp == 1) {
+			map[(unsigned char) row[0]] = i;
+		}
+		else {
+			for(k = xpm_hash(row, cpp) & (size - 1); slot[k] >= 0; k = (k + 1) & (size - 1))
+				;
+			slot[k] = i;
+		}
+	}
+
+	/* pixels */
+	for(y = 0; y < h; y++) {
+		row = lines[1 + ncolors + y];
+		if((int) strnlen(row, w * cpp) < w * cpp)
+			goto error;
+
+		for(x = 0; x < w; x++, row += cpp) {
+			if(cpp == 1) {
+				index = map[(unsigned char) *row];
+			}
+			else {
+				for(k = xpm_hash(row, cpp) & (size - 1); slot[k] >= 0; k = (k + 1) & (size - 1)) {
+					if(memcmp(keys + slot[k] * cpp, row, cpp) == 0)
+						break;
+				}
+				index = slot[k];
+			}
+			if(index < 0)
+				goto error;
+			xpm->data[y * w + x] = index;
+		}
+	}
+
+	free(slot);
+	free(keys);
+	return 0;
+
+error:
+	free(slot);
+	free(keys);
+	xpmread_free(xpm);
+	return -1;
+}
+
+/* xpmread_file
+ *  PARAMETERS:
+ *      char *filename   : XPM file to read
+ *      DecodedXpm *xpm  : returns the decoded image
+ *  RETURN:
+ *      int : 0 on success, -1 on error, -2 if libXpm should be tried
+ */
+int xpmread_file(char *filename, DecodedXpm *xpm)
+{
+	struct stat st;
+	char *buf, *p, **strings;
+	ssize_t n;
+	size_t done;
+	int fd, count, status;
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	if(fstat(fd, &st) < 0 || st.st_size > MAX_FILE_SIZE) {
+		close(fd);
+		return -1;
+	}
+
+	buf = (char *) malloc(st.st_size + 1);
+	if(!buf) {
+		close(fd);
+		return -1;
+	}
+
+	for(done = 0; done < (size_t) st.st_size; done += n) {
+		n = read(fd, buf + done, st.st_size - done);
+		if(n <= 0)
+			break;
+	}
+	close(fd);
+	buf[done] = '\0';
+
+	/* only C style XPM 3 files are handled here */
+	for(p = buf; isspace((unsigned char) *p); p++)
+		;
+	if(strncmp(p, "/* XPM */", 9) != 0) {
+		free(buf);
+		return -2;
+	}
+
+	strings = xpm_strings(p, &count);
+	status = strings ? xpm_parse(strings, count, xpm) : -1;
+
+	free(strings);
+	free(buf);
+	return status;
+}
+
+/* xpmread_data
+ *  PARAMETERS:
+ *      char **data      : XPM data included in the program
+ *      DecodedXpm *xpm  : returns the decoded image
+ *  RETURN:
+ *      int : 0 on success, <0 if the data is broken
+ */
+int xpmread_data(char **data, DecodedXpm *xpm)
+{
+	/* the array is as long as its header says */
+	return xpm_parse(data, INT_MAX, xpm);
+}
+
+/* xpmread_keep_images - hands the uploaded images to the caller if it
+ * asked for them, frees them otherwise */
+static void xpmread_keep_images(XImage *image, XImage *mask, XImage **ximage, XImage **xmask)
+{
+	if(ximage) {
+		*ximage = image;
+		*xmask = mask;
+		return;
+	}
+
+	XDestroyImage(image);
+	if(mask)
+		XDestroyImage(mask);
+}
+
+/* xpmread_create_pixmap
+ *  PARAMETERS:
+ *      Display *display : X11 display
+ *      DecodedXpm *xpm  : decoded image
+ *      Pixmap *pixmap   : returns the image
+ *      Pixmap *pixmask  : returns a depth-1 mask, None if opaque
+ *      XImage **ximage  : returns the uploaded image, may be NULL
+ *      XImage **xmask   : returns the uploaded mask, NULL if opaque
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int xpmread_create_pixmap(Display *display, DecodedXpm *xpm, Pixmap *pixmap, Pixmap *pixmask,
+                          XImage **ximage, XImage **xmask)
+{
+	XImage *image, *mask = NULL;
+	unsigned long *pixel;
+	unsigned int index;
+	Window root;
+	int screen, depth, i, x, y, transparent = 0;
+
+	if(ximage)
+		*ximage = *xmask = NULL;
+
+	screen = DefaultScreen(display);
+	depth = DefaultDepth(display, screen);
+	root = RootWindow(display, screen);
+
+	pixel = (unsigned long *) malloc(sizeof(unsigned long) * xpm->ncolors);
+	if(!pixel)
+		return -1;
+	for(i = 0; i < xpm->ncolors; i++) {
+		if(xpm->color[i])
+			dockapp_alloc_color(xpm->color[i], &pixel[i]);
+		else
+			transparent = 1;
+	}
+
+	image = XCreateImage(display, DefaultVisual(display, screen), depth, ZPixmap, 0, NULL,
+	                     xpm->width, xpm->height, 32, 0);
+	if(image)
+		image->data = (char *) malloc(image->bytes_per_line * xpm->height);
+	if(transparent) {
+		mask = XCreateImage(display, DefaultVisual(display, screen), 1, XYPixmap, 0, NULL,
+		                    xpm->width, xpm->height, 8, 0);
+		if(mask)
+			mask->data = (char *) calloc(mask->bytes_per_line, xpm->height);
+	}
+	if(!image || !image->data || (transparent && (!mask || !mask->data))) {
+		if(image)
+			XDestroyImage(image);
+		if(mask)
+			XDestroyImage(mask);
+		free(pixel);
+		return -1;
+	}
+
+	for(y = 0; y < xpm->height; y++) {
+		for(x = 0; x < xpm->width; x++) {
+			index = xpm->data[y * xpm->width + x];
+			if(xpm->color[index]) {
+				XPutPixel(image, x, y, pixel[index]);
+				if(mask)
+					XPutPixel(mask, x, y, 1);
+			}
+			else {
+				XPutPixel(image, x, y, 0);
+			}
+		}
+	}
+	free(pixel);
+
+	*pixmap = XCreatePixmap(display, root, xpm->width, xpm->height, depth);
+	if(image_gc == None)
+		image_gc = XCreateGC(display, *pixmap, 0, NULL);
+	XPutImage(display, *pixmap, image_gc, image, 0, 0, 0, 0, xpm->width, xpm->height);
+
+	*pixmask = None;
+	if(mask) {
+		*pixmask = XCreatePixmap(display, root, xpm->width, xpm->height, 1);
+		if(mask_gc == None)
+			mask_gc = XCreateGC(display, *pixmask, 0, NULL);
+		XPutImage(display, *pixmask, mask_gc, mask, 0, 0, 0, 0, xpm->width, xpm->height);
+	}
+
+	xpmread_keep_images(image, mask, ximage, xmask);
+
+	return 0;
+}
+
+/* xpmread_create_scaled_pixmap
+ *  PARAMETERS:
+ *      Display *display : X11 display
+ *      DecodedXpm *xpm  : decoded image
+ *      int width        : width to scale to
+ *      int height       : height to scale to
+ *      Pixmap *pixmap   : returns the image
+ *      Pixmap *pixmask  : returns a depth-1 mask, None if opaque
+ *      XImage **ximage  : returns the uploaded image, may be NULL
+ *      XImage **xmask   : returns the uploaded mask, NULL if opaque
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int xpmread_create_scaled_pixmap(Display *display, DecodedXpm *xpm, int width, int height,
+                                 Pixmap *pixmap, Pixmap *pixmask, XImage **ximage, XImage **xmask)
+{
+	XImage *image, *mask = NULL;
+	unsigned int *argb, *src, *dst = NULL, rgb;
+	unsigned char *bits = NULL;
+	Window root;
+	int screen, depth, i, x, y, status = -1;
+	long n = (long) xpm->width * xpm->height;
+
+	if(width == xpm->width && height == xpm->height)
+		return xpmread_create_pixmap(display, xpm, pixmap, pixmask, ximage, xmask);
+
+	if(ximage)
+		*ximage = *xmask = NULL;
+
+	screen = DefaultScreen(display);
+	depth = DefaultDepth(display, screen);
+	root = RootWindow(display, screen);
+
+	/* premultiplied colors, transparent is all zero */
+	argb = (unsigned int *) malloc(sizeof(unsigned int) * xpm->ncolors);
+	src = (unsigned int *) malloc(sizeof(unsigned int) * n);
+	if(!argb || !src) {
+		free(argb);
+		free(src);
+		return -1;
+	}
+	for(i = 0; i < xpm->ncolors; i++) {
+		argb[i] = 0;
+		if(xpm->color[i]) {
+			dockapp_color_rgb(xpm->color[i], &rgb);
+			argb[i] = 0xff000000 | rgb;
+		}
+	}
+	for(i = 0; i < n; i++)
+		src[i] = argb[xpm->data[i]];
+	free(argb);
+
+	dst = (unsigned int *) malloc(sizeof(unsigned int) * width * height);
+	bits = (unsigned char *) malloc((width + 7) / 8 * height);
+	if(!dst || !bits || scale_argb(src, xpm->width, xpm->height, dst, width, height) < 0) {
+		free(src);
+		free(dst);
+		free(bits);
+		/* too large to filter, keep it as it is */
+		return xpmread_create_pixmap(display, xpm, pixmap, pixmask, ximage, xmask);
+	}
+	free(src);
+
+	image = XCreateImage(display, DefaultVisual(display, screen), depth, ZPixmap, 0, NULL,
+	                     width, height, 32, 0);
+	if(image)
+		image->data = (char *) malloc(image->bytes_per_line * height);
+	/* the mask is built in the server's bit order, like the unscaled one */
+	if(scale_alpha_to_mask(dst, width, height, bits)) {
+		mask = XCreateImage(display, DefaultVisual(display, screen), 1, XYPixmap, 0, NULL,
+		                    width, height, 8, 0);
+		if(mask)
+			mask->data = (char *) calloc(mask->bytes_per_line, height);
+	}
+	if(image && image->data && (!mask || mask->data)) {
+		for(y = 0; y < height; y++) {
+			for(x = 0; x < width; x++) {
+				rgb = dst[y * width + x];
+				XPutPixel(image, x, y, rgb & 0x80000000 ? dockapp_rgb_pixel(rgb & 0xffffff) : 0);
+				if(mask)
+					XPutPixel(mask, x, y, rgb >> 31);
+			}
+		}
+
+		*pixmap = XCreatePixmap(display, root, width, height, depth);
+		if(image_gc == None)
+			image_gc = XCreateGC(display, *pixmap, 0, NULL);
+		XPutImage(display, *pixmap, image_gc, image, 0, 0, 0, 0, width, height);
+
+		*pixmask = None;
+		if(mask) {
+			*pixmask = XCreatePixmap(display, root, width, height, 1);
+			if(mask_gc == None)
+				mask_gc = XCreateGC(display, *pixmask, 0, NULL);
+			XPutImage(display, *pixmask, mask_gc, mask, 0, 0, 0, 0, width, height);
+		}
+
+		xpmread_keep_images(image, mask, ximage, xmask);
+		status = 0;
+	}
+	else {
+		if(image)
+			XDestroyImage(image);
+		if(mask)
+			XDestroyImage(mask);
+	}
+
+	free(dst);
+	free(bits);
+
+	return status;
+}
+
+/* xpmread_free
+ *  PARAMETERS:
+ *      DecodedXpm *xpm : image to release
+ */
+void xpmread_free(DecodedXpm *xpm)
+{
+	int i;
+
+	if(xpm->color) {
+		for(i = 0; i < xpm->ncolors; i++)
+			free(xpm->color[i]);
+		free(xpm->color);
+	}
+	free(xpm->data);
+	memset(xpm, 0, sizeof(DecodedXpm));
+}
@@ -0,0 +1,120 @@
+/* xpmread.h
+ *
+ * WMAppl - Window Maker Application Launcher
+ * Copyright (C) 1999-2004 Casey Harkins
+ *
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __XPMREAD_H__
+#define __XPMREAD_H__
+
+#include "../config.h"
+#include <X11/Xlib.h>
+
+/* a decoded XPM image, not yet tied to a display */
+typedef struct _DecodedXpm_ {
+	int width, height;
+	int ncolors;
+	char **color;		/* color of each index, NULL if transparent */
+	unsigned int *data;	/* color index of each pixel, row by row */
+} DecodedXpm;
+
+/* xpmread_file
+ *  PARAMETERS:
+ *      char *filename   : XPM file to read
+ *      DecodedXpm *xpm  : returns the decoded image
+ *
+ *  NOTE:
+ *      Parses the file in a single pass without talking to the X
+ *      server, so it is safe to call from any thread. Release the
+ *      image with xpmread_free.
+ *
+ *  RETURN:
+ *      int : 0 on success, -1 if the file can't be read or is broken,
+ *            -2 if it is in a form this reader doesn't handle (XPM1/2,
+ *            compressed files), libXpm can still be tried then
+ */
+int
+xpmread_file(char *filename, DecodedXpm *xpm);
+
+/* xpmread_data
+ *  PARAMETERS:
+ *      char **data      : XPM data included in the program
+ *      DecodedXpm *xpm  : returns the decoded image
+ *
+ *  RETURN:
+ *      int : 0 on success, <0 if the data is broken
+ */
+int
+xpmread_data(char **data, DecodedXpm *xpm);
+
+/* xpmread_create_pixmap
+ *  PARAMETERS:
+ *      Display *display : X11 display
+ *      DecodedXpm *xpm  : decoded image
+ *      Pixmap *pixmap   : returns the image
+ *      Pixmap *pixmask  : returns a depth-1 mask, None if opaque
+ *      XImage **ximage  : returns the uploaded image, may be NULL
+ *      XImage **xmask   : returns the uploaded mask, NULL if opaque
+ *
+ *  NOTE:
+ *      Colors are resolved through a process-wide cache, so each color
+ *      name costs at most one request for the whole program. On
+ *      TrueColor visuals pixel values are computed locally. The pixmap
+ *      and the mask are uploaded with one XPutImage each. If ximage is
+ *      given, the client-side images are handed back rather than freed,
+ *      so the caller can keep the pixels without reading them back;
+ *      release them with XDestroyImage.
+ *
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int
+xpmread_create_pixmap(Display *display, DecodedXpm *xpm, Pixmap *pixmap, Pixmap *pixmask,
+                      XImage **ximage, XImage **xmask);
+
+/* xpmread_create_scaled_pixmap
+ *  PARAMETERS:
+ *      Display *display : X11 display
+ *      DecodedXpm *xpm  : decoded image
+ *      int width        : width to scale to
+ *      int height       : height to scale to
+ *      Pixmap *pixmap   : returns the image
+ *      Pixmap *pixmask  : returns a depth-1 mask, None if opaque
+ *      XImage **ximage  : returns the uploaded image, may be NULL
+ *      XImage **xmask   : returns the uploaded mask, NULL if opaque
+ *
+ *  NOTE:
+ *      Like xpmread_create_pixmap, but images of another size are box
+ *      filtered to width x height first (see scale.h). Pixels that end
+ *      up at least half covered are kept in the mask.
+ *
+ *  RETURN:
+ *      int : 0 on success, <0 on error
+ */
+int
+xpmread_create_scaled_pixmap(Display *display, DecodedXpm *xpm, int width, int height,
+                             Pixmap *pixmap, Pixmap *pixmask, XImage **ximage, XImage **xmask);
+
+/* xpmread_free
+ *  PARAMETERS:
+ *      DecodedXpm *xpm : image to release
+ */
+void
+xpmread_free(DecodedXpm *xpm);
+
+#endif /* not __XPMREAD_H__ */